@@ -16,6 +16,15 @@
 #include "agent.h"
 #include "episode.h"
 #include "statistic.h"
+#include "cpu.h"
+#include "distill.h"
+#include "prune.h"
+#include "openings.h"
+#include "tuner.h"
+#include "bench.h"
+#include "farm.h"
+#include "trainer.h"
+#include "snapshot.h"
 
 int main(int argc, const char* argv[]) {
 	std::cout << "2584-Demo: ";
@@ -23,8 +32,9 @@ int main(int argc, const char* argv[]) {
 	std::cout << std::endl << std::endl;
 
 	size_t total = 1000, block = 0, limit = 0;
-	std::string play_args, evil_args;
-	std::string load, save;
+	std::string play_args, evil_args, distill_args, prune_args, book_args, tune_args, bench_args, farm_args, train_args;
+	std::string load, save, snap, resume;
+	std::string isa = "auto";
 	bool summary = false;
 	for (int i = 1; i < argc; i++) {
 		std::string para(argv[i]);
@@ -42,11 +52,37 @@ int main(int argc, const char* argv[]) {
 			load = para.substr(para.find("=") + 1);
 		} else if (para.find("--save=") == 0) {
 			save = para.substr(para.find("=") + 1);
+		} else if (para.find("--snapshot=") == 0) {
+			snap = para.substr(para.find("=") + 1);
+		} else if (para.find("--resume=") == 0) {
+			resume = para.substr(para.find("=") + 1);
 		} else if (para.find("--summary") == 0) {
 			summary = true;
+		} else if (para.find("--distill=") == 0) {
+			distill_args = para.substr(para.find("=") + 1);
+		} else if (para.find("--prune=") == 0) {
+			prune_args = para.substr(para.find("=") + 1);
+		} else if (para.find("--book=") == 0) {
+			book_args = para.substr(para.find("=") + 1);
+		} else if (para.find("--tune=") == 0) {
+			tune_args = para.substr(para.find("=") + 1);
+		} else if (para.find("--bench=") == 0) {
+			bench_args = para.substr(para.find("=") + 1);
+		} else if (para.find("--farm=") == 0) {
+			farm_args = para.substr(para.find("=") + 1);
+		} else if (para.find("--train=") == 0) {
+			train_args = para.substr(para.find("=") + 1);
+		} else if (para.find("--isa=") == 0) {
+			isa = para.substr(para.find("=") + 1);
 		}
 	}
 
+	if (!cpu::select(isa)) {
+		std::cerr << "unsupported instruction set: " << isa << std::endl;
+		return -1;
+	}
+	std::cout << "isa = " << cpu::name(cpu::level()) << " (detected " << cpu::name(cpu::detect()) << ")" << std::endl << std::endl;
+
 	statistic stat(total, block, limit);
 
 	if (load.size()) {
@@ -56,9 +92,60 @@ int main(int argc, const char* argv[]) {
 		summary |= stat.is_finished();
 	}
 
+	if (bench_args.size()) {
+		scaling_bench(play_args, bench_args).run();
+		return 0;
+	}
+
+	if (train_args.size()) {
+		parallel_trainer(play_args, train_args).run();
+		return 0;
+	}
+
+	if (farm_args.size()) {
+		checkpoint_farm(play_args, farm_args).run();
+		std::cout << memory::footprint() << std::endl;
+		return 0;
+	}
+
 	player play(play_args);
 	// dummy_player play(play_args);
+
+	if (distill_args.size()) {
+		player student("name=student " + distill_args);
+		distiller(play, student).run();
+		std::cout << memory::footprint() << std::endl;
+		return 0;
+	}
+
+	if (prune_args.size()) {
+		pruner(play, prune_args).run();
+		return 0;
+	}
+
+	if (book_args.size()) {
+		book_builder(play, book_args).run();
+		return 0;
+	}
+
+	if (tune_args.size()) {
+		cut_tuner(play, tune_args).run();
+		return 0;
+	}
+
 	rndenv evil(evil_args);
+	stat.attach([&]() { return play.report(); });
+	if (resume.size()) {
+		if (!std::ifstream(resume).is_open()) {
+			std::cout << "resume = " << resume << " not found, start from the beginning" << std::endl;
+		} else if (!snapshot::load(resume, stat, play, evil)) {
+			std::cerr << "invalid snapshot: " << resume << std::endl;
+			return -1;
+		} else {
+			std::cout << "resume = " << resume << " at episode " << stat.episodes() << std::endl;
+		}
+	}
+	std::cout << memory::footprint() << std::endl << std::endl;
 
 	while (!stat.is_finished()) {
 		play.open_episode("~:" + evil.name());
@@ -77,6 +164,11 @@ int main(int argc, const char* argv[]) {
 
 		play.close_episode(win.name());
 		evil.close_episode(win.name());
+
+		if (snap.size() && (stat.is_block_end() || stat.is_finished()) && !snapshot::save(snap, stat, play, evil, save.size() || summary)) {
+			std::cerr << "cannot save snapshot: " << snap << std::endl;
+			return -1;
+		}
 	}
 
 	if (summary) {
@@ -89,5 +181,6 @@ int main(int argc, const char* argv[]) {
 		out.close();
 	}
 
+	std::cout << memory::footprint() << std::endl;
 	return 0;
 }
@@ -14,9 +14,28 @@
 #include <map>
 #include <type_traits>
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "board.h"
 #include "action.h"
 #include "weight.h"
+#include "ntuple.h"
+#include "memory.h"
+#include "book.h"
+#include "parallel.h"
+#include "slide.h"
+#include "heuristic.h"
+#include "budget.h"
+#include "cuts.h"
+#include "cache.h"
+#include "reload.h"
+#include "bootstrap.h"
 #include <fstream>
 
 class agent {
@@ -35,6 +54,12 @@ public:
 	virtual action take_action(const board& b) { return action(); }
 	virtual bool check_for_win(const board& b) { return false; }
 
+	/**
+	 * the state needed to continue exactly where the agent stopped, see snapshot.h
+	 */
+	virtual void save_state(std::ostream& out) const {}
+	virtual void load_state(std::istream& in) {}
+
 public:
 	virtual std::string property(const std::string& key) const { return meta.at(key); }
 	virtual void notify(const std::string& msg) { meta[msg.substr(0, msg.find('='))] = { msg.substr(msg.find('=') + 1) }; }
@@ -63,139 +88,1110 @@ public:
 	}
 	virtual ~random_agent() {}
 
+	virtual void save_state(std::ostream& out) const { out << engine << '\n'; }
+	virtual void load_state(std::istream& in) { in >> engine; in.ignore(1); }
+
 protected:
 	std::default_random_engine engine;
 };
 
+/**
+ * learning dynamics of the TD updates, accumulated per block of statistic
+ *
+ * the report would be
+ * td = -2.1 (rms 318.6), new = 52113|31904|77250, touched = 3.1%|2.0%|4.5%, max = 1302.7
+ *
+ * where
+ *  'td = -2.1 (rms 318.6)': the mean and the root mean square of the TD errors
+ *  'new = 52113|...': the number of entries of each table updated for the first time in the block
+ *  'touched = 3.1%|...': the fraction of entries of each table that have ever been updated
+ *  'max = 1302.7': the maximum absolute weight of the entries updated in the block
+ *
+ * the maximum is taken as the entries are updated, since a scan of all tables per block would
+ * touch tens of millions of entries, including the cold pages of mapped tables
+ */
+class dynamics {
+public:
+	dynamics() : count(0), sum(0), sqsum(0), max(0) {}
+
+	void record(const std::vector<weight>& net, float error, const uint32_t* index) {
+		if (touched.size() != net.size()) reset(net);
+		count++;
+		sum += error;
+		sqsum += double(error) * error;
+		for (size_t i = 0; i < net.size(); i++) {
+			for (unsigned s = 0; s < isomorphism::count; s++) {
+				uint32_t j = index[i * isomorphism::count + s];
+				auto bit = touched[i][j];
+				if (!bit) bit = true, visited[i]++, fresh[i]++;
+				max = std::max(max, std::abs(net[i][j] + net[i].offset()));
+			}
+		}
+	}
+
+	/**
+	 * report the dynamics of the current block and start a new block
+	 */
+	std::string report(const std::vector<weight>& net) {
+		if (touched.size() != net.size()) return "";
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(1);
+		ss << "td = " << (count ? sum / count : 0) << " (rms " << (count ? std::sqrt(sqsum / count) : 0) << "), ";
+		ss << "new = ";
+		for (size_t i = 0; i < net.size(); i++) ss << (i ? "|" : "") << fresh[i];
+		ss << ", touched = ";
+		for (size_t i = 0; i < net.size(); i++) ss << (i ? "|" : "") << (visited[i] * 100.0 / touched[i].size()) << "%";
+		ss << ", max = " << max;
+		count = 0;
+		sum = sqsum = 0;
+		max = 0;
+		std::fill(fresh.begin(), fresh.end(), 0);
+		return ss.str();
+	}
+
+	size_t bytes() const {
+		size_t sum = 0;
+		for (const std::vector<bool>& t : touched) sum += t.capacity() / 8;
+		return sum + (fresh.capacity() + visited.capacity()) * sizeof(size_t);
+	}
+
+public:
+	friend std::ostream& operator <<(std::ostream& out, const dynamics& d) {
+		uint64_t size = d.touched.size();
+		out.write(reinterpret_cast<const char*>(&d.count), sizeof(d.count));
+		out.write(reinterpret_cast<const char*>(&d.sum), sizeof(d.sum));
+		out.write(reinterpret_cast<const char*>(&d.sqsum), sizeof(d.sqsum));
+		out.write(reinterpret_cast<const char*>(&d.max), sizeof(d.max));
+		out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+		for (size_t i = 0; i < size; i++) {
+			uint64_t bits = d.touched[i].size();
+			out.write(reinterpret_cast<const char*>(&d.fresh[i]), sizeof(size_t));
+			out.write(reinterpret_cast<const char*>(&d.visited[i]), sizeof(size_t));
+			out.write(reinterpret_cast<const char*>(&bits), sizeof(bits));
+			std::vector<uint8_t> bytes((bits + 7) / 8);
+			for (size_t j = 0; j < bits; j++) bytes[j / 8] |= d.touched[i][j] << (j % 8);
+			out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		}
+		return out;
+	}
+	friend std::istream& operator >>(std::istream& in, dynamics& d) {
+		uint64_t size = 0;
+		in.read(reinterpret_cast<char*>(&d.count), sizeof(d.count));
+		in.read(reinterpret_cast<char*>(&d.sum), sizeof(d.sum));
+		in.read(reinterpret_cast<char*>(&d.sqsum), sizeof(d.sqsum));
+		in.read(reinterpret_cast<char*>(&d.max), sizeof(d.max));
+		in.read(reinterpret_cast<char*>(&size), sizeof(size));
+		d.touched.assign(size, {});
+		d.fresh.assign(size, 0);
+		d.visited.assign(size, 0);
+		for (size_t i = 0; i < size && in; i++) {
+			uint64_t bits = 0;
+			in.read(reinterpret_cast<char*>(&d.fresh[i]), sizeof(size_t));
+			in.read(reinterpret_cast<char*>(&d.visited[i]), sizeof(size_t));
+			in.read(reinterpret_cast<char*>(&bits), sizeof(bits));
+			std::vector<uint8_t> bytes((bits + 7) / 8);
+			in.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+			d.touched[i].resize(bits);
+			for (size_t j = 0; j < bits; j++) d.touched[i][j] = (bytes[j / 8] >> (j % 8)) & 1;
+		}
+		return in;
+	}
+
+private:
+	void reset(const std::vector<weight>& net) {
+		touched.assign(net.size(), {});
+		for (size_t i = 0; i < net.size(); i++) touched[i].assign(net[i].size(), false);
+		fresh.assign(net.size(), 0);
+		visited.assign(net.size(), 0);
+	}
+
+	size_t count;
+	double sum, sqsum;
+	float max;
+	std::vector<size_t> fresh;
+	std::vector<size_t> visited;
+	std::vector<std::vector<bool>> touched;
+};
+
 /**
  * base agent for agents with weight tables and a learning rate
  */
 class player : public agent {
 public:
-	player(const std::string& args = "") : agent("name=dummy role=play " + args), alpha(0) {
+	player(const std::string& args = "") : agent("name=dummy role=play tuple=01234,45678,01245 " + args), fast(false), alpha(0), base(0), cached(0), version(0), depth(1),
+		tabled(0), budget_nodes(false), untrained(false), warm(0), reloads(net) {
+		tuples = ntuple::parse(meta["tuple"]);
+		cells = feature_cells(tuples);
 		if (meta.find("init") != meta.end())
 			init_weights(meta["init"]);
 		if (meta.find("load") != meta.end())
 			load_weights(meta["load"]);
+		if (meta.find("map") != meta.end())
+			map_weights(meta["map"]);
+		if (meta.find("compact") != meta.end())
+			load_compact(meta["compact"]);
+		if (meta.find("optimistic") != meta.end()) {
+			if (meta.find("init") == meta.end() || meta.find("load") != meta.end() || meta.find("map") != meta.end() || meta.find("compact") != meta.end()) {
+				std::cerr << "optimistic requires init, saved weights already include the offset" << std::endl;
+				std::exit(-1);
+			}
+			optimistic(meta["optimistic"]);
+		}
 		if (meta.find("alpha") != meta.end())
-			alpha = float(meta["alpha"])/24;
+			alpha = float(meta["alpha"]) / (tuples.size() * isomorphism::count);
+		if (meta.find("cache") != meta.end())
+			cached = meta["cache"];
+		if (cached & (cached - 1)) {
+			std::cerr << "cache= must be a power of two: " << cached << std::endl;
+			std::exit(-1);
+		}
+		if (meta.find("depth") != meta.end())
+			depth = std::max(int(meta["depth"]), 1);
+		if (meta.find("table") != meta.end())
+			tabled = meta["table"];
+		if (tabled & (tabled - 1)) {
+			std::cerr << "table= must be a power of two: " << tabled << std::endl;
+			std::exit(-1);
+		}
+		if (meta.find("probcut") != meta.end() && !cuts.load(meta["probcut"]))
+			std::exit(-1);
+		if (meta.find("cut") != meta.end())
+			cuts.margin(meta["cut"]);
+		if (meta.find("time") != meta.end() || meta.find("nodes") != meta.end())
+			plan_budget();
+		if (meta.find("book") != meta.end() && !book.open(meta["book"]))
+			std::exit(-1);
+		if (meta.find("bootstrap") != meta.end())
+			bootstrap(meta["bootstrap"]);
+		untrained = net->empty() && sparse.empty();
+		if (meta.find("prefault") != meta.end() || meta.find("lock") != meta.end())
+			warm_up(meta.find("lock") != meta.end() ? 2 : 1);
+		if (meta.find("reload") != meta.end())
+			hot_swap(meta["reload"]);
+		version.store(value_cache::version(), std::memory_order_relaxed);
+		memory::track("net", this, [this]() {
+			size_t bytes = 0;
+			for (const weight& w : *net) bytes += w.size() * sizeof(weight::type);
+			for (const sparse_weight& w : sparse) bytes += w.bytes();
+			return bytes;
+		});
+		memory::track("history", this, [this]() {
+			return history.after.capacity() * sizeof(board::packed) + history.reward.capacity() * sizeof(board::reward);
+		});
+		memory::track("dynamics", this, [this]() { return learning.bytes(); });
+		memory::track("book", this, [this]() { return book.bytes(); });
 	}
 	virtual ~player() {
+		reloads.stop();
+		memory::untrack(this);
+		if (targets.enabled()) {
+			targets.stop();
+			absorb();
+		}
 		if (meta.find("save") != meta.end())
 			save_weights(meta["save"]);
 	}
 	virtual action take_action(const board& before) {
-		int best_op = -1;
-		int best_reward = -1;
-		float best_value = -std::numeric_limits<float>::max();
-		board best_after;
+		decision best = budget.enabled() ? plan(before) : decide(before);
+		if(best.op != -1){
+			history.push_back(best.reward, best.after);
+		} 
+		return action::slide(best.op);
+	}
+
+	/**
+	 * the decision of a board, without recording it
+	 * the opening book is consulted first, then the board is searched to the configured depth
+	 * op is -1 if there is no legal move
+	 */
+	struct decision {
+		int op;
+		board::reward reward;
+		float value;
+		board after;
+	};
+	decision decide(const board& before) const {
+		section reading(reloads);
+		decision best;
+		if (consult(before, best)) return best;
+		begin_search();
+		return search(before, depth);
+	}
+
+	/**
+	 * the decision of a board by iterative deepening within the allotment of the search budget,
+	 * which is charged for the effort, see search_budget
+	 */
+	decision plan(const board& before) {
+		section reading(reloads);
+		decision best;
+		if (consult(before, best)) return best;
+		begin_search();
+		double allotted = budget.allot(before), spent = 0, last = 0, previous = 0;
+		unsigned d = 1;
+		for (;; d++) {
+			auto start = std::chrono::steady_clock::now();
+			size_t nodes = searched();
+			float second;
+			best = search(before, d, &second);
+			double cost = budget_nodes ? double(searched() - nodes) : std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			previous = last;
+			last = cost;
+			spent += cost;
+			if (best.op == -1 || second == -std::numeric_limits<float>::max()) break;
+			if (!budget.deepen(d, last, previous, spent, allotted, best.reward + best.value, second)) break;
+		}
+		budget.spend(spent, d);
+		return best;
+	}
+
+	/**
+	 * the move of the opening book for a board, if any
+	 */
+	bool consult(const board& before, decision& move) const {
+		int op;
+		float value;
+		if (!book.find(before, op, value)) return false;
+		board after = before;
+		board::reward reward = after.slide(op);
+		if (reward == -1) return false;
+		move = { op, reward, value, after };
+		return true;
+	}
+
+	/**
+	 * start the search of a new move, which ages the search table of this thread (if any),
+	 * see search_table; called before search() or expect() by each caller of them
+	 */
+	void begin_search() const {
+		if (tabled) search_table::local().age(tabled);
+	}
+
+	/**
+	 * expectimax search, where plies is the number of moves of the player to look ahead
+	 * and 1 ply is the greedy decision; the value of a decision is the expected return
+	 * after its afterstate, and the leaves are evaluated by the network
+	 */
+	decision search(const board& before, unsigned plies, float* second = nullptr) const {
+		decision best = { -1, -1, -std::numeric_limits<float>::max(), {} };
+		board after[4];
+		int opcode[4], rewards[4];
+		float values[4];
+		size_t legal = 0;
 		for(int op:{0, 1, 2, 3}){
-			board after = before;
-			int reward = after.slide(op);
+			after[legal] = before;
+			int reward = after[legal].slide(op);
 			if(reward == -1)continue;
+			opcode[legal] = op;
+			rewards[legal++] = reward;
+		}
+		searched() += legal;
+		if (plies <= 1) {
+			estimate_values(after, legal, values);
+		} else if (!cuts.covers(plies - 1)) {
+			for (size_t i = 0; i < legal; i++) values[i] = expect(after[i], plies - 1);
+		} else {
+			float total[4];
+			estimate_values(after, legal, values);
+			for (size_t i = 0; i < legal; i++) total[i] = rewards[i] + values[i];
+			float tolerance = cuts.margin() * cuts.at(plies - 1).sigma;
+			for (size_t i = 0; i < legal; i++) values[i] = expect(after[i], plies - 1, std::max(gap(total, legal, i) - tolerance, 0.0f));
+		}
+		float runner = -std::numeric_limits<float>::max();
+		for(size_t i = 0; i < legal; i++){
+			if(rewards[i] + values[i] > best.value + best.reward){
+				if (best.op != -1) runner = best.value + best.reward;
+				best = { opcode[i], rewards[i], values[i], after[i] };
+			} else {
+				runner = std::max(runner, rewards[i] + values[i]);
+			}
+		}
+		if (second) *second = runner;
+		return best;
+	}
 
-			float value = estimate_value(after);
-			if(reward + value > best_value + best_reward){
-				best_op = op;
-				best_reward = reward;
-				best_value = value;
-				best_after = after;
+	/**
+	 * the expected return of an afterstate, over the tiles placed by the environment
+	 * (a 1-tile with 90% and a 2-tile with 10% at a uniformly random empty cell)
+	 *
+	 * all children are expanded at once, each direction by a single call of slides(),
+	 * and the afterstates of the last level are evaluated in one batch, see leaf_values()
+	 *
+	 * slack is how far the value may be off before it could change the decision above,
+	 * which allows forward pruning of the children, see forward_prune()
+	 */
+	float expect(const board& after, unsigned plies, float slack = 0) const {
+		board::packed packed = after.pack();
+		if (!tabled) return expand(packed, plies, slack);
+		search_table& table = search_table::local();
+		uint64_t current = version.load(std::memory_order_relaxed);
+		float value;
+		if (table.find(packed, plies, slack, current, value)) return value;
+		value = expand(packed, plies, slack);
+		table.store(packed, plies, slack, current, value);
+		return value;
+	}
+	float expand(const board::packed& packed, unsigned plies, float slack) const {
+		board::packed child[32];
+		float prob[32];
+		size_t n = 0;
+		for (int pos = 0; pos < 16; pos++) {
+			if (packed(pos) != 0) continue;
+			for (auto tile : { std::make_pair(1u, 0.9f), std::make_pair(2u, 0.1f) }) {
+				child[n] = packed;
+				child[n](pos) = tile.first;
+				prob[n++] = tile.second;
 			}
 		}
-		if(best_op != -1){
-			history.push_back({best_reward, best_after});
-		} 
-		return action::slide(best_op);
+		if (n == 0) return 0;
+
+		board::packed next[4][32];
+		board::reward reward[4][32];
+		board leaf[4 * 32];
+		float value[4 * 32];
+		size_t m = 0;
+		for (unsigned op = 0; op < 4; op++) {
+			slides(child, next[op], op, n, reward[op]);
+			for (size_t k = 0; k < n; k++)
+				if (reward[op][k] != -1) leaf[m++] = board(next[op][k]);
+		}
+		searched() += m;
+		if (plies <= 1 && !cached && !fast && !untrained) {
+			leaf_values(packed, next, reward, n, value);
+		} else if (plies <= 1) {
+			estimate_values(leaf, m, value);
+		} else if (!cuts.covers(plies)) {
+			for (size_t i = 0; i < m; i++) value[i] = expect(leaf[i], plies - 1);
+		} else {
+			forward_prune(leaf, reward, n, m, prob, plies, slack, value);
+		}
+
+		float best[32];
+		std::fill(best, best + n, -std::numeric_limits<float>::max());
+		for (unsigned op = 0, i = 0; op < 4; op++) {
+			for (size_t k = 0; k < n; k++)
+				if (reward[op][k] != -1) best[k] = std::max(best[k], reward[op][k] + value[i++]);
+		}
+		float sum = 0;
+		for (size_t k = 0; k < n; k++)
+			if (best[k] != -std::numeric_limits<float>::max()) sum += prob[k] * best[k];
+		return sum / (n / 2);
 	}
-	
-	struct step
-	{
-		int reward;
-		board after;
+
+	/**
+	 * ProbCut-like forward pruning of the children of a chance node, whose values would be
+	 * searched to the given depth, from their shallow values (the greedy values by the network)
+	 * and the fitted models of cut_model, where the margin z is given by cut=
+	 *
+	 * a child (a tile placed in a cell) is skipped and valued by its model a * shallow + b if its
+	 * possible error, its weight times z * sigma, still fits in half of the slack of the node,
+	 * starting from the lightest children (the 2-tiles); of the other children, a move whose
+	 * shallow value is behind the best by more than z * sigma is skipped, and the others are
+	 * searched with the slack of their gap to the best other move (at most half of the slack)
+	 */
+	void forward_prune(const board* leaf, const board::reward reward[4][32], size_t n, size_t m,
+			const float* prob, unsigned plies, float slack, float* value) const {
+		const cut_model::line& model = cuts.at(plies);
+		const float tolerance = cuts.margin() * model.sigma;
+		const float lowest = -std::numeric_limits<float>::max();
+		float shallow[4 * 32];
+		estimate_values(leaf, m, shallow);
+
+		int index[4][32];
+		for (unsigned op = 0, i = 0; op < 4; op++)
+			for (size_t k = 0; k < n; k++) index[op][k] = reward[op][k] != -1 ? int(i++) : -1;
+
+		unsigned order[32];
+		for (unsigned k = 0; k < n; k++) order[k] = k;
+		std::stable_sort(order, order + n, [&](unsigned x, unsigned y) { return prob[x] < prob[y]; });
+		float spent = 0;
+		for (size_t j = 0; j < n; j++) {
+			unsigned k = order[j];
+			float total[4];
+			unsigned moves = 0, top = 0;
+			int of[4];
+			for (unsigned op = 0; op < 4; op++) {
+				if (index[op][k] == -1) continue;
+				of[moves] = index[op][k];
+				total[moves] = reward[op][k] + shallow[index[op][k]];
+				if (total[moves] > total[top]) top = moves;
+				moves++;
+			}
+			if (!moves) continue;
+			float error = prob[k] / (n / 2) * tolerance;
+			if (spent + error <= slack / 2) {
+				spent += error;
+				for (unsigned i = 0; i < moves; i++) value[of[i]] = lowest;
+				value[of[top]] = model.a * total[top] + model.b - (total[top] - shallow[of[top]]);
+				continue;
+			}
+			for (unsigned i = 0; i < moves; i++) {
+				if (total[i] < total[top] - tolerance) {
+					value[of[i]] = lowest;
+					continue;
+				}
+				value[of[i]] = expect(leaf[of[i]], plies - 1, std::min(std::max(gap(total, moves, i) - tolerance, 0.0f), slack / 2));
+			}
+		}
+	}
+
+	/**
+	 * the models of forward pruning, an empty model searches without pruning
+	 */
+	void forward_pruning(const cut_model& model) { cuts = model; }
+
+	/**
+	 * the gap between the i-th value and the best of the others
+	 */
+	static float gap(const float* total, size_t n, size_t i) {
+		float other = -std::numeric_limits<float>::max();
+		for (size_t j = 0; j < n; j++)
+			if (j != i) other = std::max(other, total[j]);
+		return n > 1 ? std::abs(total[i] - other) : std::numeric_limits<float>::max();
+	}
+
+	/**
+	 * the afterstates and rewards of an episode, stored as packed boards
+	 * the buffers are kept across episodes and reserved from the length of the previous one
+	 */
+	class trajectory {
+	public:
+		void clear() {
+			size_t last = after.size();
+			after.clear();
+			reward.clear();
+			after.reserve(last);
+			reward.reserve(last);
+		}
+		void push_back(board::reward r, const board& b) {
+			reward.push_back(r);
+			after.push_back(b.pack());
+		}
+		size_t size() const { return after.size(); }
+		bool empty() const { return after.empty(); }
+
+	public:
+		std::vector<board::packed> after;
+		std::vector<board::reward> reward;
 	};
 
 	virtual void open_episode(const std::string& flag = "") {
 		history.clear();
+		budget.open_game();
 	}
 	virtual void close_episode(const std::string& flag = "") {
+		budget.close_game();
 		if(history.empty()) return;
 		if(alpha == 0) return;
-		adjust_value(history[history.size() - 1].after, 0);
+		section reading(reloads);
+		if (targets.enabled()) absorb();
+		if (targets.enabled()) targets.sample(history.after);
+		const board::packed* after = history.after.data();
+		const board::reward* reward = history.reward.data();
+		if (!targets.searched(history.size() - 1)) adjust_value(after[history.size() - 1], 0);
 		for(int t = history.size()-2; t >= 0; t--){
-			adjust_value(history[t].after, 
-			history[t+1].reward + estimate_value(history[t+1].after));
+			if (targets.searched(t)) continue;
+			adjust_value(after[t], reward[t+1] + estimate_value(after[t+1]));
 		}
 	}
-	std::vector<step> history;
-	
+	trajectory history;
+
 	void adjust_value(const board& after, float target){
-		float current = estimate_value(after);
+		adjust_value(after.pack(), target);
+	}
+	void adjust_value(const board::packed& after, float target){
+		if (cached || tabled) version.store(value_cache::version(), std::memory_order_relaxed);
+		uint32_t* index = feature_buffer(1);
+		feature_index(after, index);
+		float current = accumulate(index);
 		float error = target - current;
 		float adjust = alpha * error;
-		board temp_board = after;
-		for(int j=0;j<2;j++){
-			for(int i=0;i<4;i++){
-				temp_board.rotate_right();
-				net[0][extract_feature(temp_board, 0, 1, 2, 3, 4)] += adjust;
-				net[1][extract_feature(temp_board, 4, 5, 6, 7, 8)]+= adjust;
-				net[2][extract_feature(temp_board, 0, 1, 2, 4, 5)]+= adjust;
+		std::vector<weight>& tables = view();
+		for (size_t i = 0; i < tables.size(); i++)
+			for (unsigned s = 0; s < isomorphism::count; s++)
+				tables[i][index[i * isomorphism::count + s]] += adjust;
+		learning.record(tables, error, index);
+	}
+
+	/**
+	 * the number of table entries of a board, i.e., the entries updated by an adjustment
+	 */
+	size_t features() const { return tuples.size() * isomorphism::count; }
+
+	/**
+	 * adjust the value of an afterstate from one of many threads sharing this player,
+	 * which updates the tables only (neither the dynamics nor the version of the weights, so the
+	 * values kept by cache= and table= would go stale, and the callers run without them)
+	 * the entries are updated in place without synchronization (hogwild), or by compare-and-swap
+	 * loops if atomic is set, in which case the number of retries is returned
+	 */
+	size_t adjust_shared(const board::packed& after, float target, bool atomic) {
+		uint32_t* index = feature_buffer(1);
+		feature_index(after, index);
+		float adjust = alpha * (target - accumulate(index));
+		size_t retries = 0;
+		std::vector<weight>& tables = view();
+		for (size_t i = 0; i < tables.size(); i++) {
+			for (unsigned s = 0; s < isomorphism::count; s++) {
+				float& w = tables[i][index[i * isomorphism::count + s]];
+				if (!atomic) {
+					w += adjust;
+					continue;
+				}
+				uint32_t* raw = reinterpret_cast<uint32_t*>(&w);
+				uint32_t old = __atomic_load_n(raw, __ATOMIC_RELAXED), now;
+				do {
+					float v;
+					std::memcpy(&v, &old, sizeof(v));
+					v += adjust;
+					std::memcpy(&now, &v, sizeof(now));
+				} while (!__atomic_compare_exchange_n(raw, &old, now, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED) && ++retries);
 			}
-			temp_board.reflect_horizontal();
 		}
-	}
-	int extract_feature(const board& after, int a, int b, int c, int d, int e, int f) const {
-		return after(a) * 25 * 25 * 25 * 25 * 25 + after(b) * 25 * 25 * 25 * 25 + after(c) * 25 * 25 * 25 + after(d) * 25 * 25 + after(e) * 25 + after(f);
+		return retries;
 	}
 
-	int extract_feature(const board& after, int a, int b, int c, int d, int e) const {
-		return after(a) * 25 * 25 * 25 * 25 + after(b)* 25 * 25 * 25 + after(c) * 25 * 25 + after(d) * 25 + after(e);
+	/**
+	 * the value of an afterstate from its feature indices, which are also returned
+	 * (isomorphism::count indices per table), for the adjustments applied later by adjust_entry
+	 */
+	float estimate_value(const board::packed& after, uint32_t* index) const {
+		section reading(reloads);
+		feature_index(after, index);
+		return accumulate(index);
 	}
-	int extract_feature(const board& after, int a, int b, int c, int d) const {
-		return after(a) * 25 * 25 * 25 + after(b) * 25 * 25 + after(c) * 25 + after(d);
+	/**
+	 * add to an entry of a table from one of many threads which own disjoint entries,
+	 * where the cached values are to be invalidated once after the whole batch
+	 */
+	void adjust_entry(size_t table, uint32_t entry, float adjust) {
+		view()[table][entry] += adjust;
 	}
-	
+	void invalidate() {
+		if (cached || tabled) version.store(value_cache::version(), std::memory_order_relaxed);
+	}
+	float learning_rate() const { return alpha; }
+	size_t entries(size_t table) const { return (*net)[table].size(); }
+
 	float estimate_value(const board& after) const{
-		float value = 0;
-		board temp_board = after;
-		for(int j=0;j<2;j++){
-			for(int i=0;i<4;i++){
-				temp_board.rotate_right();
-				value += net[0][extract_feature(temp_board, 0, 1, 2, 3, 4)];
-				value += net[1][extract_feature(temp_board, 4, 5, 6, 7, 8)];
-				value += net[2][extract_feature(temp_board, 0, 1, 2, 4, 5)];
-			}
-			temp_board.reflect_horizontal();
+		return estimate_value(after.pack());
+	}
+	float estimate_value(const board::packed& after) const{
+		section reading(reloads);
+		if (!cached) return evaluate(after);
+		value_cache& cache = value_cache::local();
+		cache.resize(cached);
+		float value;
+		if (cache.find(after, version.load(std::memory_order_relaxed), value)) return value;
+		value = evaluate(after);
+		cache.store(after, version.load(std::memory_order_relaxed), value);
+		return value;
+	}
+
+	/**
+	 * estimate the values of n boards at once
+	 * all feature indices are computed first and prefetched, then the values are accumulated
+	 */
+	void estimate_values(const board* boards, size_t n, float* out) const {
+		section reading(reloads);
+		if (!cached) return evaluate(boards, n, out);
+		value_cache& cache = value_cache::local();
+		cache.resize(cached);
+		const size_t chunk = 16;
+		for (; n > chunk; n -= chunk, boards += chunk, out += chunk) estimate_values(boards, chunk, out);
+		board miss[chunk];
+		board::packed packed[chunk];
+		float value[chunk];
+		size_t pos[chunk], m = 0;
+		for (size_t k = 0; k < n; k++) {
+			packed[k] = boards[k].pack();
+			if (cache.find(packed[k], version.load(std::memory_order_relaxed), out[k])) continue;
+			miss[m] = boards[k];
+			pos[m++] = k;
+		}
+		evaluate(miss, m, value);
+		for (size_t i = 0; i < m; i++) {
+			out[pos[i]] = value[i];
+			cache.store(packed[pos[i]], version.load(std::memory_order_relaxed), value[i]);
 		}
-		
+	}
+
+	/**
+	 * evaluate boards by the network, without the cache, or by the heuristic if there are no weights
+	 */
+	float evaluate(const board::packed& after) const{
+		if (untrained) return heuristic::evaluate(after);
+		if (sparse.size()) {
+			uint32_t* index = feature_buffer(1);
+			feature_index(after, index);
+			prefetch(index);
+			return accumulate(index);
+		}
+		if (fast) return base + production::estimate(view().data(), after);
+		board::packed iso[isomorphism::count];
+		isomorphisms(after, iso);
+		const std::vector<weight>& tables = view();
+		float value = base;
+		for (size_t i = 0; i < tuples.size(); i++)
+			value += tuples[i].estimate(tables[i], iso);
 		return value;
 	}
+
+	void evaluate(const board* boards, size_t n, float* out) const {
+		if (untrained) {
+			for (size_t k = 0; k < n; k++) out[k] = heuristic::evaluate(boards[k]);
+			return;
+		}
+		const size_t features = tuples.size() * isomorphism::count;
+		const uint32_t* index = batch_index(boards, n);
+		for (size_t k = 0; k < n; k++, index += features) {
+			out[k] = accumulate(index);
+		}
+	}
+
+	/**
+	 * mark the feature indices of a board in the visited bitsets, one bitset per table
+	 */
+	void visit(const board& b, std::vector<std::vector<bool>>& visited) const {
+		if (visited.size() != net->size()) {
+			visited.resize(net->size());
+			for (size_t i = 0; i < net->size(); i++) visited[i].assign((*net)[i].size(), false);
+		}
+		uint32_t* index = feature_buffer(1);
+		feature_index(b.pack(), index);
+		for (size_t i = 0; i < net->size(); i++)
+			for (unsigned s = 0; s < isomorphism::count; s++)
+				visited[i][index[i * isomorphism::count + s]] = true;
+	}
+
+	/**
+	 * save the visited entries as compact tables, which can be loaded by "compact="
+	 */
+	void save_compact(const std::string& path, const std::vector<std::vector<bool>>& visited, float miss = 0) const {
+		std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) std::exit(-1);
+		uint32_t size = net->size();
+		out.write(reinterpret_cast<char*>(&size), sizeof(size));
+		for (size_t i = 0; i < net->size(); i++) out << sparse_weight((*net)[i], visited[i], miss);
+		out.close();
+	}
+
+	/**
+	 * the training state: the raw entries and the lazy offsets of the tables (so that the
+	 * following updates round exactly as they would have), the learning dynamics of the
+	 * current block, and the credit and the counters of bootstrap=
+	 *
+	 * the episode in progress is not included, i.e., the state is taken between episodes;
+	 * the targets of bootstrap= still in flight are not included either, so runs with
+	 * helpers are not reproduced exactly (they are not deterministic anyway)
+	 */
+	virtual void save_state(std::ostream& out) const {
+		if (sparse.size()) {
+			std::cerr << "the state of compact tables cannot be saved" << std::endl;
+			std::exit(-1);
+		}
+		uint32_t size = net->size();
+		out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+		for (const weight& w : *net) {
+			uint64_t length = w.size();
+			weight::type bias = w.offset();
+			out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+			out.write(reinterpret_cast<const char*>(&bias), sizeof(bias));
+			out.write(reinterpret_cast<const char*>(w.data()), sizeof(weight::type) * length);
+		}
+		out.write(reinterpret_cast<const char*>(&base), sizeof(base));
+		out << targets << learning;
+	}
+	virtual void load_state(std::istream& in) {
+		uint32_t size = 0;
+		in.read(reinterpret_cast<char*>(&size), sizeof(size));
+		if (size != tuples.size()) {
+			std::cerr << "the state has " << size << " tables, but tuple= has " << tuples.size() << std::endl;
+			std::exit(-1);
+		}
+		std::vector<weight> tables;
+		for (uint32_t i = 0; i < size && in; i++) {
+			uint64_t length = 0;
+			weight::type bias = 0;
+			in.read(reinterpret_cast<char*>(&length), sizeof(length));
+			in.read(reinterpret_cast<char*>(&bias), sizeof(bias));
+			tables.emplace_back(length);
+			tables.back().offset(bias);
+			in.read(reinterpret_cast<char*>(tables.back().data()), sizeof(weight::type) * length);
+		}
+		*net = std::move(tables);
+		in.read(reinterpret_cast<char*>(&base), sizeof(base));
+		in >> targets >> learning;
+		specialize();
+		untrained = false;
+		version.store(value_cache::version(), std::memory_order_relaxed);
+	}
+
+	/**
+	 * commands, e.g., "reload=weights.bin" swaps in the weights of a file if hot swapping is enabled
+	 */
+	virtual void notify(const std::string& msg) {
+		if (msg.find("reload=") == 0 && reloads.request(msg.substr(msg.find('=') + 1))) return;
+		agent::notify(msg);
+	}
+
+	/**
+	 * the learning dynamics and the cache hit rate of the current block, or an empty string if neither is used;
+	 * the counts of bootstrap= are since the start, as its targets are applied in later blocks
+	 */
+	std::string report() {
+		std::string res = learning.report(*net);
+		if (cached) res += (res.size() ? ", " : "") + value_cache::local().report();
+		if (tabled) res += (res.size() ? ", " : "") + search_table::local().report();
+		if (targets.enabled()) res += (res.size() ? ", " : "") + targets.report();
+		if (budget.enabled()) res += (res.size() ? ", " : "") + budget.report();
+		return res;
+	}
+
+	/**
+	 * the production topology, evaluated by the compile-time specialized network
+	 * other topologies given by "tuple=" fall back to the runtime patterns
+	 */
+	typedef ntuple_network<pattern<0, 1, 2, 3, 4>, pattern<4, 5, 6, 7, 8>, pattern<0, 1, 2, 4, 5>> production;
+
 protected:
 	virtual void init_weights(const std::string& info) {
-		net.emplace_back(25 * 25 * 25 * 25 * 25);
-		net.emplace_back(25 * 25 * 25 * 25 * 25);
-		net.emplace_back(25 * 25 * 25 * 25 * 25);
+		for (const ntuple& t : tuples) net->emplace_back(t.length());
+		specialize();
+	}
+	/**
+	 * load compact tables built by --prune, for evaluation only
+	 */
+	virtual void load_compact(const std::string& path) {
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		if (!in.is_open()) std::exit(-1);
+		uint32_t size;
+		in.read(reinterpret_cast<char*>(&size), sizeof(size));
+		net->clear();
+		sparse.resize(size);
+		for (sparse_weight& w : sparse) in >> w;
+		in.close();
+		specialize();
+		base = 0;
 	}
 	virtual void load_weights(const std::string& path) {
 		std::ifstream in(path, std::ios::in | std::ios::binary);
 		if (!in.is_open()) std::exit(-1);
 		uint32_t size;
 		in.read(reinterpret_cast<char*>(&size), sizeof(size));
-		net.resize(size);
-		for (weight& w : net) in >> w;
+		net->resize(size);
+		for (weight& w : *net) in >> w;
 		in.close();
+		specialize();
+		base = 0;
+	}
+	/**
+	 * map a weight file into memory instead of reading it, so that the pages are only loaded
+	 * when the entries are touched; the mapping is private, i.e., updates are not written back
+	 */
+	virtual void map_weights(const std::string& path) {
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) std::exit(-1);
+		struct stat st;
+		if (fstat(fd, &st) != 0) std::exit(-1);
+		size_t bytes = st.st_size;
+		void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (ptr == MAP_FAILED) std::exit(-1);
+		std::shared_ptr<void> region(ptr, [bytes](void* p) { munmap(p, bytes); });
+		char* cur = static_cast<char*>(ptr);
+		char* end = cur + bytes;
+		uint32_t size;
+		if (end - cur < ptrdiff_t(sizeof(size))) std::exit(-1);
+		std::memcpy(&size, cur, sizeof(size));
+		cur += sizeof(size);
+		net->clear();
+		for (uint32_t i = 0; i < size; i++) {
+			uint64_t length;
+			if (end - cur < ptrdiff_t(sizeof(length))) std::exit(-1);
+			std::memcpy(&length, cur, sizeof(length));
+			cur += sizeof(length);
+			if (uint64_t(end - cur) / sizeof(weight::type) < length) std::exit(-1);
+			net->emplace_back(region, reinterpret_cast<weight::type*>(cur), length);
+			cur += length * sizeof(weight::type);
+		}
+		specialize();
+		base = 0;
+	}
+	/**
+	 * optimistic initialization, spread a value evenly across all features
+	 * the value is kept as the lazy offsets of the tables instead of written to every entry,
+	 * which are added into the entries on save, so it is only accepted with init
+	 */
+	virtual void optimistic(float value) {
+		if (net->empty()) return;
+		float share = value / (net->size() * isomorphism::count);
+		base = 0;
+		for (weight& w : *net) {
+			w.offset(w.offset() + share);
+			base += w.offset() * isomorphism::count;
+		}
+	}
+	/**
+	 * the values of the legal afterstates next[op][k] of the n children of an afterstate,
+	 * in the order of op and then k, with their feature indices maintained incrementally
+	 *
+	 * a child differs from the afterstate by one placed tile, so sliding it only changes
+	 * the line of that tile compared with sliding the afterstate itself; the indices of the
+	 * 4 slid afterstates are computed once, and each leaf updates at most 4 cells of them
+	 *
+	 * this pays off for the runtime patterns, while the specialized production network
+	 * computes the indices from scratch faster than they can be updated
+	 */
+	void leaf_values(const board::packed& after, const board::packed next[][32], const board::reward reward[][32], size_t n, float* value) const {
+		const size_t features = tuples.size() * isomorphism::count;
+		uint32_t* index = feature_buffer(4 + 4 * n);
+		uint32_t* leaf = index + 4 * features;
+		size_t m = 0;
+		for (unsigned op = 0; op < 4; op++) {
+			board moved(after);
+			moved.slide(op);
+			board::packed slid = moved.pack();
+			feature_index(slid, index + op * features);
+			for (size_t k = 0; k < n; k++) {
+				if (reward[op][k] == -1) continue;
+				uint32_t* idx = leaf + (m++) * features;
+				cells.update(index + op * features, idx, slid, next[op][k]);
+				prefetch(idx);
+			}
+		}
+		for (size_t i = 0; i < m; i++) value[i] = accumulate(leaf + i * features);
+	}
+	/**
+	 * prefetch the entries of the feature indices of a board
+	 */
+	void prefetch(const uint32_t* index) const {
+		for (size_t i = 0; i < sparse.size(); i++)
+			for (unsigned s = 0; s < isomorphism::count; s++)
+				sparse[i].prefetch(index[i * isomorphism::count + s]);
+		const std::vector<weight>& tables = view();
+		for (size_t i = 0; i < tables.size(); i++)
+			for (unsigned s = 0; s < isomorphism::count; s++)
+				__builtin_prefetch(&tables[i][index[i * isomorphism::count + s]]);
+	}
+	/**
+	 * compute the feature indices of n boards into a per-thread buffer, and prefetch the entries
+	 * the indices of the k-th board start at k * tuples.size() * isomorphism::count
+	 */
+	const uint32_t* batch_index(const board* boards, size_t n) const {
+		const size_t features = tuples.size() * isomorphism::count;
+		uint32_t* index = feature_buffer(n);
+		for (size_t k = 0; k < n; k++, index += features) {
+			feature_index(boards[k].pack(), index);
+			prefetch(index);
+		}
+		return batch_buffer().data();
+	}
+	/**
+	 * the per-thread buffer for the feature indices of n boards
+	 */
+	uint32_t* feature_buffer(size_t n) const {
+		batch_buffer().resize(n * tuples.size() * isomorphism::count);
+		return batch_buffer().data();
+	}
+	/**
+	 * the value of a board from its feature indices
+	 */
+	float accumulate(const uint32_t* index) const {
+		float value = base;
+		for (size_t i = 0; i < sparse.size(); i++)
+			for (unsigned s = 0; s < isomorphism::count; s++)
+				value += sparse[i][index[i * isomorphism::count + s]];
+		const std::vector<weight>& tables = view();
+		for (size_t i = 0; i < tables.size(); i++)
+			for (unsigned s = 0; s < isomorphism::count; s++)
+				value += tables[i][index[i * isomorphism::count + s]];
+		return value;
+	}
+	/**
+	 * the feature indices of a board, isomorphism::count indices per table
+	 */
+	void feature_index(const board::packed& b, uint32_t* index) const {
+		if (fast) {
+			production::index(b, index);
+			return;
+		}
+		board::packed iso[isomorphism::count];
+		isomorphisms(b, iso);
+		for (size_t i = 0; i < tuples.size(); i++)
+			tuples[i].index(iso, index + i * isomorphism::count);
+	}
+	/**
+	 * search-bootstrapped targets, e.g., "bootstrap=0.1 lookahead=1 helpers=2", where the targets
+	 * are computed by an expectimax of lookahead moves over the current network, see search_bootstrap
+	 *
+	 * the helpers read the tables while they are being updated, which may see a mix of
+	 * old and new weights, as the targets are already a bit stale when applied
+	 */
+	void bootstrap(float fraction) {
+		if (alpha == 0 || fraction <= 0) return;
+		unsigned lookahead = meta.find("lookahead") != meta.end() ? std::max(int(meta["lookahead"]), 1) : 1;
+		size_t threads = meta.find("helpers") != meta.end() ? std::max(size_t(meta["helpers"]), size_t(1)) : 1;
+		targets.start(fraction, threads, [this, lookahead](const board::packed& after) {
+			begin_search();
+			return expect(board(after), lookahead);
+		});
+	}
+	/**
+	 * apply the targets finished by the helpers so far
+	 */
+	void absorb() {
+		targets.absorb([this](const board::packed& after, float target) { adjust_value(after, target); });
+	}
+	/**
+	 * hot swapping of the weights, e.g., "reload=weights.bin"
+	 *
+	 * the tables are published as a snapshot, which the requests (decide, estimate_value, ...)
+	 * read within an epoch; a loader thread reads the new weights in the background on SIGHUP
+	 * (from the path of reload=) or on notify("reload=path"), publishes them, and deletes the old
+	 * tables once the requests that started before the swap have left, see reloader
+	 *
+	 * the new weights must have the same tables as the current ones, and the value cache
+	 * and the lazy offsets of optimistic= are not used with hot swapping; neither are learning,
+	 * since the updates could be written into tables that were just retired, and the search
+	 * table, since its entries of the old weights could answer the requests on the new ones
+	 */
+	void hot_swap(const std::string& path) {
+		if (base != 0 || sparse.size()) {
+			std::cerr << "reload is not supported with optimistic or compact tables" << std::endl;
+			std::exit(-1);
+		}
+		if (alpha != 0) {
+			std::cerr << "reload is not supported with learning, use alpha=0" << std::endl;
+			std::exit(-1);
+		}
+		if (tabled) {
+			std::cerr << "reload is not supported with the search table, use table=0" << std::endl;
+			std::exit(-1);
+		}
+		cached = 0;
+		reloads.start(path, [this](const std::string& path) { return read_weights(path); });
+	}
+	typedef reloader<std::vector<weight>>::section section;
+	/**
+	 * the tables pinned by the section of this thread, or the published ones without hot swapping
+	 */
+	std::vector<weight>& view() const { return reloads.view(); }
+	/**
+	 * the weights of a file to be swapped in, or nullptr if its tables do not match the current ones
+	 */
+	std::vector<weight>* read_weights(const std::string& path) const {
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		std::unique_ptr<std::vector<weight>> fresh(new std::vector<weight>);
+		uint32_t size = 0;
+		if (in.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+			fresh->resize(size);
+			for (weight& w : *fresh) in >> w;
+		}
+		bool match = in && fresh->size() == net->size();
+		for (size_t i = 0; match && i < fresh->size(); i++) match = (*fresh)[i].size() == (*net)[i].size();
+		if (!match) {
+			std::cerr << "reload = " << path << " failed, the tables do not match" << std::endl;
+			return nullptr;
+		}
+		if (warm) prefault(*fresh);
+		return fresh.release();
+	}
+	/**
+	 * fault in the pages of the weight tables and the search tables (the value cache of this
+	 * thread and the opening book), so that the first moves do not stall on page faults,
+	 * e.g., "prefault", or also lock them in memory against swapping, e.g., "lock"
+	 *
+	 * the tables are written on the touch if the player learns, since a read of an untouched
+	 * page only maps a shared page (the zero page, or the file of map=) that faults again on
+	 * the first write; note that locking a map= file while learning copies all of its pages
+	 */
+	void warm_up(unsigned level) {
+		warm = level;
+		auto start = std::chrono::steady_clock::now();
+		size_t bytes = 0;
+		bool locked = prefault(*net);
+		for (const weight& w : *net) bytes += w.size() * sizeof(weight::type);
+		for (const sparse_weight& w : sparse) {
+			locked &= memory::prefault(w.data(), w.bytes(), false, warm > 1);
+			bytes += w.bytes();
+		}
+		if (cached) {
+			value_cache& cache = value_cache::local();
+			cache.resize(cached);
+			locked &= memory::prefault(cache.data(), cache.bytes(), true, warm > 1);
+			bytes += cache.bytes();
+		}
+		locked &= memory::prefault(book.data(), book.bytes(), false, warm > 1);
+		bytes += book.bytes();
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cerr << "warm = " << memory::human(bytes) << " in " << std::fixed << std::setprecision(1) << ms << " ms";
+		std::cerr << (warm > 1 ? (locked ? ", locked" : ", not locked (see ulimit -l)") : "") << std::endl;
+	}
+	bool prefault(std::vector<weight>& tables) const {
+		bool locked = true;
+		for (weight& w : tables)
+			locked &= memory::prefault(w.data(), w.size() * sizeof(weight::type), alpha != 0, warm > 1);
+		return locked;
+	}
+	/**
+	 * a per-game search budget, e.g., "time=2000" milliseconds or "nodes=50000000" searched
+	 * afterstates per game, where depth= (4 by default) is the maximal depth of a move,
+	 * and close= is the relative gap of the best two moves that doubles the allotment
+	 */
+	void plan_budget() {
+		budget_nodes = meta.find("nodes") != meta.end();
+		double total = budget_nodes ? double(meta["nodes"]) : double(meta["time"]);
+		unsigned limit = meta.find("depth") != meta.end() ? depth : 4;
+		float close = meta.find("close") != meta.end() ? float(meta["close"]) : 0.02f;
+		budget = search_budget(total, budget_nodes ? "nodes" : "ms", limit, close, tabled != 0);
+	}
+	/**
+	 * the afterstates generated by the searches of this thread
+	 */
+	static size_t& searched() { static thread_local size_t count = 0; return count; }
+
+	static std::vector<uint32_t>& batch_buffer() { static thread_local std::vector<uint32_t> buf; return buf; }
+
+	/**
+	 * use the specialized network if the tuples and the tables match the production topology
+	 */
+	void specialize() {
+		std::vector<std::vector<unsigned>> topology;
+		for (const ntuple& t : tuples) topology.push_back(t.topology());
+		fast = topology == production::topology() && net->size() == production::tables && production::match(net->data());
+		if (sparse.size()) fast = topology == production::topology();
 	}
 	virtual void save_weights(const std::string& path) {
 		std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
 		if (!out.is_open()) std::exit(-1);
-		uint32_t size = net.size();
+		uint32_t size = net->size();
 		out.write(reinterpret_cast<char*>(&size), sizeof(size));
-		for (weight& w : net) out << w;
+		for (weight& w : *net) out << w;
 		out.close();
 	}
 
 protected:
-	std::vector<weight> net;
+	published<std::vector<weight>> net;
+	std::vector<sparse_weight> sparse;
+	std::vector<ntuple> tuples;
+	feature_cells cells;
+	bool fast;
 	float alpha;
+	float base;
+	dynamics learning;
+	size_t cached;
+	std::atomic<uint64_t> version; // read by the helpers of bootstrap= while the updates change it
+	unsigned depth;
+	opening_book book;
+	search_bootstrap targets;
+	size_t tabled;
+	search_budget budget;
+	cut_model cuts;
+	bool budget_nodes;
+	bool untrained; // no weights are given, so boards are evaluated by the heuristic
+	unsigned warm;
+	reloader<std::vector<weight>> reloads;
 };
 
 /**
@@ -219,6 +1215,19 @@ public:
 		return action();
 	}
 
+	/**
+	 * the random engine and the order of the cells, which is shuffled from the last order
+	 */
+	virtual void save_state(std::ostream& out) const {
+		random_agent::save_state(out);
+		for (size_t i = 0; i < space.size(); i++) out << space[i] << (i + 1 < space.size() ? ' ' : '\n');
+	}
+	virtual void load_state(std::istream& in) {
+		random_agent::load_state(in);
+		for (int& pos : space) in >> pos;
+		in.ignore(1);
+	}
+
 private:
 	std::array<int, 16> space;
 	std::uniform_int_distribution<int> popup;
@@ -226,7 +1235,8 @@ private:
 
 /**
  * dummy player
- * select a legal action randomly
+ * select a legal action randomly, or by the given mode, e.g., "heuristic" selects the move
+ * of the largest reward plus heuristic::evaluate of its afterstate (a fast rollout policy)
  */
 
 class dummy_player : public random_agent {
@@ -269,52 +1279,19 @@ public:
 			return action::slide(idx);
 		}
 		else if(action_op == "heuristic"){
-			struct op{
-				int code;
-				board after;
-				int val;
-				op(const board& b, int o):code(o), after(b), val(after.slide(code)){}
-				bool operator <(const op& b) const{return val < b.val;}
-			} op[] = {{before, 0}, {before, 1}, {before, 2}, {before, 3}};
-			int mv = 0;
-			for(int i=0;i<16;i++) if(before(i) > before(mv))mv = i;
-			for(int i:{0,1,2,3}){
-				if(op[i].val == -1)continue;
-				
-				int max_loc = 0;
-				int num_space = 0;
-				for (int j:{0, 1, 2, 3}){
-					board rotate_board = op[i].after;
-					rotate_board.rotate(j);
-					int id[] = {0, 4, 8, 12};
-					for(int t = 0; t<4;t++){
-						if( abs(rotate_board(id[t]) - rotate_board(id[t]+1)) == 1  || (rotate_board(id[t]) == 1 && rotate_board(id[t]+1) == 1)) op[i].val += 3;
-						if( abs(rotate_board(id[t]+1) - rotate_board(id[t]+2)) == 1 || (rotate_board(id[t]+1) == 1 && rotate_board(id[t]+2) == 1)) op[i].val += 3;
-						if( abs(rotate_board(id[t]+2) - rotate_board(id[t]+3)) == 1 || (rotate_board(id[t]+2) == 1 && rotate_board(id[t]+3) == 1)) op[i].val += 3;
-					}
-					board origin = op[i].after;
-					if(origin.slide(j) == -1)continue;
-					
-					for(int t = 0;t < 16; t++){
-						if(origin(t) == 0)
-							num_space += 1;
-					}
-					
-					op[i].val += num_space * 2;
-				}
-				for(int t = 0; t<16;t++){
-					if(op[i].after(t) > op[i].after(max_loc))
-						max_loc = t;
-				}
-				if(max_loc == 0 || max_loc == 3 || max_loc == 12 || max_loc == 15)
-					op[i].val += op[i].after(max_loc);
-				if(max_loc == mv && op[i].after(max_loc) > 6){
-					op[i].val += board::fib(op[i].after(max_loc) - 2);
+			float value = -std::numeric_limits<float>::max();
+			int idx = -1;
+			for (int op : opcode) {
+				board after = before;
+				board::reward reward = after.slide(op);
+				if (reward == -1) continue;
+				float v = reward + heuristic::evaluate(after);
+				if (v > value) {
+					value = v;
+					idx = op;
 				}
-				
 			}
-			std::sort(op, op+4);
-			return action::slide(op[3].code);
+			return idx != -1 ? action::slide(idx) : action();
 		}
 		else{
 			for (int op : opcode) {
@@ -0,0 +1,164 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * bench.h: Thread scaling benchmark of the parallel evaluator and trainer
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sys/resource.h>
+#include "board.h"
+#include "agent.h"
+#include "tool.h"
+
+/**
+ * run the parallel evaluator and the parallel trainer at 1, 2, 4, ..., N threads
+ *
+ * strong scaling plays a fixed total of games, split across the threads; weak scaling plays
+ * a fixed number of games per thread, which is games / N so that both end at the same size
+ *
+ * the evaluator shares a const player, and each thread plays its own games
+ * the trainer shares a player too, and each thread applies the TD(0) updates of its episodes
+ * directly to the tables, either in place (hogwild) or by compare-and-swap loops (atomic=1),
+ * where the retries of the loops count the updates that collided with other threads; as these
+ * updates do not change the version of the weights, the trainer runs without cache= and table=
+ *
+ * the contention signals are the cpu utilization, the voluntary context switches (threads
+ * blocking, e.g., on locks or page faults) and the involuntary ones (more threads than cores)
+ *
+ * each run constructs a fresh player from the arguments of --play, without its save=, e.g.,
+ * --bench="threads=8 games=400 alpha=0.1 atomic=1 csv=scaling.csv"
+ */
+class scaling_bench : public tool {
+public:
+	scaling_bench(const std::string& play_args, const std::string& args = "") :
+		tool("name=bench games=100 alpha=0.1 atomic=1 seed=0 " + args),
+		play_args(without(play_args, { "save" })),
+		games(meta["games"]), seed(meta["seed"]), atomic(int(meta["atomic"])) {
+		threads = meta.find("threads") != meta.end() ? size_t(meta["threads"]) : std::thread::hardware_concurrency();
+		threads = std::max<size_t>(threads, 1);
+	}
+
+	void run() {
+		std::vector<size_t> counts;
+		for (size_t t = 1; t < threads; t *= 2) counts.push_back(t);
+		counts.push_back(threads);
+
+		std::vector<result> results;
+		for (std::string workload : { "evaluate", "train" }) {
+			for (std::string scaling : { "strong", "weak" }) {
+				double base = 0;
+				for (size_t t : counts) {
+					size_t total = scaling == "strong" ? games : std::max<size_t>(games / threads, 1) * t;
+					result res = measure(workload, t, total);
+					res.scaling = scaling;
+					if (t == 1) base = res.throughput();
+					res.speedup = base ? res.throughput() / base : 0;
+					results.push_back(res);
+					std::cout << format(res) << std::endl;
+				}
+			}
+		}
+
+		if (meta.find("csv") != meta.end()) {
+			std::ofstream out(meta["csv"], std::ios::out | std::ios::trunc);
+			if (!out.is_open()) std::exit(-1);
+			out << "workload,scaling,threads,games,seconds,games_per_sec,speedup,efficiency,cpu,vcsw,ivcsw,retries_per_mupdate" << std::endl;
+			for (const result& res : results) {
+				out << res.workload << "," << res.scaling << "," << res.threads << "," << res.games << ",";
+				out << res.seconds << "," << res.throughput() << "," << res.speedup << "," << res.efficiency() << ",";
+				out << res.cpu << "," << res.vcsw << "," << res.ivcsw << "," << res.contention() << std::endl;
+			}
+		}
+	}
+
+protected:
+	struct result {
+		std::string workload, scaling;
+		size_t threads, games;
+		double seconds, speedup, cpu;
+		long vcsw, ivcsw;
+		size_t updates, retries;
+		double throughput() const { return seconds > 0 ? games / seconds : 0; }
+		double efficiency() const { return threads ? speedup / threads : 0; }
+		double contention() const { return updates ? retries * 1e6 / updates : 0; }
+	};
+
+	result measure(const std::string& workload, size_t t, size_t total) {
+		bool train = workload == "train";
+		player play(play_args + (train ? " alpha=" + std::string(meta["alpha"]) + " cache=0 table=0" : " alpha=0"));
+		std::atomic<size_t> updates(0), retries(0);
+
+		struct rusage before, after;
+		getrusage(RUSAGE_SELF, &before);
+		auto start = std::chrono::steady_clock::now();
+		parallel(t, [&](size_t id) {
+			size_t u = 0, r = 0;
+			player::trajectory path;
+			for (size_t g = id; g < total; g += t) {
+				path.clear();
+				self_play(play, seed + g, &path);
+				if (train) r += learn(play, path), u += path.size() * play.features();
+			}
+			updates += u;
+			retries += r;
+		});
+		auto stop = std::chrono::steady_clock::now();
+		getrusage(RUSAGE_SELF, &after);
+
+		result res;
+		res.workload = workload;
+		res.threads = t;
+		res.games = total;
+		res.seconds = std::chrono::duration<double>(stop - start).count();
+		res.speedup = 0;
+		double busy = seconds(after.ru_utime) + seconds(after.ru_stime) - seconds(before.ru_utime) - seconds(before.ru_stime);
+		res.cpu = res.seconds > 0 ? busy / (res.seconds * t) : 0;
+		res.vcsw = after.ru_nvcsw - before.ru_nvcsw;
+		res.ivcsw = after.ru_nivcsw - before.ru_nivcsw;
+		res.updates = updates;
+		res.retries = retries;
+		return res;
+	}
+
+	/**
+	 * the backward TD(0) pass of close_episode, applied to the shared tables
+	 */
+	size_t learn(player& play, const player::trajectory& path) {
+		if (path.empty()) return 0;
+		size_t retries = play.adjust_shared(path.after[path.size() - 1], 0, atomic);
+		for (int t = path.size() - 2; t >= 0; t--)
+			retries += play.adjust_shared(path.after[t], path.reward[t + 1] + play.estimate_value(path.after[t + 1]), atomic);
+		return retries;
+	}
+
+	std::string format(const result& res) const {
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(2);
+		ss << res.workload << "\t" << res.scaling << "\tthreads = " << res.threads << ", games = " << res.games;
+		ss << ", " << res.throughput() << " games/s, speedup = " << res.speedup << ", efficiency = " << (res.efficiency() * 100) << "%";
+		ss << ", cpu = " << (res.cpu * 100) << "%, csw = " << res.vcsw << "|" << res.ivcsw;
+		if (res.workload == "train" && atomic) ss << ", retries = " << res.contention() << "/M";
+		return ss.str();
+	}
+
+	static double seconds(const timeval& tv) { return tv.tv_sec + tv.tv_usec * 1e-6; }
+
+private:
+	std::string play_args;
+	size_t games;
+	size_t threads;
+	size_t seed;
+	bool atomic;
+};
@@ -13,6 +13,11 @@
 #include <iomanip>
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /**
  * array-based board for 2048
@@ -32,9 +37,31 @@ public:
 	typedef uint64_t data;
 	typedef int reward;
 
+	/**
+	 * the 16 tiles packed as bytes, i.e., the layout of a 128-bit register
+	 */
+	struct alignas(16) packed {
+		uint8_t cell[16];
+		uint8_t& operator ()(unsigned i) { return cell[i]; }
+		const uint8_t& operator ()(unsigned i) const { return cell[i]; }
+
+		/**
+		 * the top bits of a 64-bit mix of the tiles, e.g., the slot in a table of 2^bits entries
+		 */
+		uint64_t hash(unsigned bits = 64) const {
+			uint64_t lo, hi;
+			std::memcpy(&lo, cell, sizeof(lo));
+			std::memcpy(&hi, cell + 8, sizeof(hi));
+			uint64_t h = (lo * 0x9e3779b97f4a7c15ull) ^ (hi * 0xc2b2ae3d27d4eb4full);
+			h = (h ^ (h >> 29)) * 0xbf58476d1ce4e5b9ull;
+			return bits ? h >> (64 - bits) : 0;
+		}
+	};
+
 public:
 	board() : tile(), attr(0) {}
 	board(const grid& b, data v = 0) : tile(b), attr(v) {}
+	board(const packed& p, data v = 0) : attr(v) { for (int i = 0; i < 16; i++) operator()(i) = p(i); }
 	board(const board& b) = default;
 	board& operator =(const board& b) = default;
 
@@ -45,6 +72,19 @@ public:
 	cell& operator ()(unsigned i) { return tile[i / 4][i % 4]; }
 	const cell& operator ()(unsigned i) const { return tile[i / 4][i % 4]; }
 
+	packed pack() const {
+		packed p;
+#if defined(__SSE2__)
+		const __m128i* t = reinterpret_cast<const __m128i*>(&tile);
+		__m128i lo = _mm_packs_epi32(_mm_loadu_si128(t + 0), _mm_loadu_si128(t + 1));
+		__m128i hi = _mm_packs_epi32(_mm_loadu_si128(t + 2), _mm_loadu_si128(t + 3));
+		_mm_store_si128(reinterpret_cast<__m128i*>(p.cell), _mm_packus_epi16(lo, hi));
+#else
+		for (int i = 0; i < 16; i++) p(i) = operator()(i);
+#endif
+		return p;
+	}
+
 	data info() const { return attr; }
 	data info(data dat) { data old = attr; attr = dat; return old; }
 	static int fib(data idx) { 
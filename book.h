@@ -0,0 +1,142 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * book.h: Memory-mapped opening book of searched early positions
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "board.h"
+#include "ntuple.h"
+
+/**
+ * opening book, a hash table from canonical boards (states before the move of the player)
+ * to their best moves and values, stored as a file and memory-mapped for lookups
+ *
+ * the canonical board is the smallest of the isomorphisms, and the best move is stored
+ * in the orientation of the canonical board
+ */
+class opening_book {
+public:
+	struct entry {
+		board::packed key;
+		float value;
+		int32_t op; // -1 for an empty slot
+	};
+
+public:
+	opening_book() : table(nullptr), capacity(0), length(0) {}
+	opening_book(const opening_book&) = delete;
+	opening_book& operator =(const opening_book&) = delete;
+	~opening_book() { close(); }
+
+	/**
+	 * map a book file, return false if it cannot be opened
+	 */
+	bool open(const std::string& path) {
+		close();
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(header)) return ::close(fd), false;
+		void* ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (ptr == MAP_FAILED) return false;
+		const header* head = static_cast<const header*>(ptr);
+		if (std::memcmp(head->magic, "2584bk02", 8) != 0 || sizeof(header) + head->capacity * sizeof(entry) > size_t(st.st_size)) {
+			munmap(ptr, st.st_size);
+			return false;
+		}
+		mapped = { ptr, size_t(st.st_size) };
+		capacity = head->capacity;
+		length = head->count;
+		table = reinterpret_cast<const entry*>(head + 1);
+		return true;
+	}
+	void close() {
+		if (table) munmap(mapped.first, mapped.second);
+		table = nullptr;
+		capacity = length = 0;
+	}
+
+	size_t size() const { return length; }
+	size_t bytes() const { return table ? mapped.second : 0; }
+	const void* data() const { return table ? mapped.first : nullptr; }
+
+	/**
+	 * find the best move of a board, which is mapped back to the orientation of the board
+	 */
+	bool find(const board& b, int& op, float& value) const {
+		if (!capacity) return false;
+		unsigned s;
+		board::packed key = canonical(b.pack(), s);
+		for (size_t h = hash(key, capacity); table[h].op != -1; h = (h + 1) % capacity) {
+			if (std::memcmp(table[h].key.cell, key.cell, sizeof(key.cell)) != 0) continue;
+			op = isomorphism::unmove(s, table[h].op);
+			value = table[h].value;
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	 * write the entries (with canonical keys) as a book file at a load factor of 0.5
+	 */
+	static bool save(const std::string& path, const std::vector<entry>& entries) {
+		header head;
+		std::memcpy(head.magic, "2584bk02", 8);
+		head.count = entries.size();
+		head.capacity = entries.size() * 2 + 1;
+		std::vector<entry> slot(head.capacity);
+		for (entry& e : slot) e.op = -1;
+		for (const entry& e : entries) {
+			size_t h = hash(e.key, head.capacity);
+			while (slot[h].op != -1) h = (h + 1) % head.capacity;
+			slot[h] = e;
+		}
+		std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) return false;
+		out.write(reinterpret_cast<const char*>(&head), sizeof(head));
+		out.write(reinterpret_cast<const char*>(slot.data()), sizeof(entry) * slot.size());
+		return true;
+	}
+
+	/**
+	 * the smallest isomorphism of a board, and which isomorphism it is
+	 */
+	static board::packed canonical(const board::packed& b, unsigned& s) {
+		board::packed iso[isomorphism::count];
+		isomorphisms(b, iso);
+		s = 0;
+		for (unsigned i = 1; i < isomorphism::count; i++)
+			if (std::memcmp(iso[i].cell, iso[s].cell, sizeof(iso[i].cell)) < 0) s = i;
+		return iso[s];
+	}
+
+private:
+	struct header {
+		char magic[8];
+		uint64_t count;
+		uint64_t capacity;
+	};
+
+	static size_t hash(const board::packed& b, size_t capacity) {
+		return b.hash() % capacity;
+	}
+
+	const entry* table;
+	size_t capacity;
+	size_t length;
+	std::pair<void*, size_t> mapped;
+};
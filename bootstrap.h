@@ -0,0 +1,111 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * bootstrap.h: Search-bootstrapped training targets computed by helper threads
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#include "board.h"
+#include "parallel.h"
+
+/**
+ * a fraction of the afterstates of each episode are sent to helper threads, which compute
+ * their targets by a search given by the player; the targets are applied at the end of later
+ * episodes, so the search overlaps with the games, and replace the TD(0) updates of the
+ * sampled afterstates rather than adding to them
+ *
+ * the counters are kept since the start, as the targets are applied in later blocks
+ */
+class search_bootstrap {
+public:
+	typedef std::pair<board::packed, float> target;
+
+	search_bootstrap() : rate(0), credit(0), submitted(0), dropped(0), applied(0) {}
+
+	bool enabled() const { return bool(helpers); }
+
+	/**
+	 * sample the given fraction of the afterstates, whose targets are search(after) by threads of helpers
+	 */
+	void start(float fraction, size_t threads, std::function<float(const board::packed&)> search) {
+		rate = std::min(fraction, 1.0f);
+		helpers.reset(new async_pool<board::packed, target>(threads, [search](const board::packed& after) {
+			return target(after, search(after));
+		}));
+	}
+	/**
+	 * finish the submitted afterstates, whose targets remain to be absorbed
+	 */
+	void stop() {
+		if (helpers) helpers->stop();
+	}
+
+	/**
+	 * submit every 1/rate-th afterstate of an episode to the helpers; the submitted ones take
+	 * the targets of the helpers instead of the TD(0) updates of the episode, see searched()
+	 */
+	void sample(const std::vector<board::packed>& path) {
+		handed.assign(path.size(), false);
+		for (size_t t = 0; t < path.size(); t++) {
+			if ((credit += rate) < 1) continue;
+			credit -= 1;
+			board::packed after = path[t];
+			if (helpers->submit(std::move(after))) submitted++, handed[t] = true;
+			else dropped++;
+		}
+	}
+	/**
+	 * whether the t-th afterstate of the episode was submitted to the helpers by sample()
+	 */
+	bool searched(size_t t) const {
+		return helpers && handed[t];
+	}
+	/**
+	 * apply the targets finished by the helpers so far by adjust(after, target)
+	 */
+	template<typename update>
+	void absorb(update adjust) {
+		for (target res; helpers->poll(res); applied++)
+			adjust(res.first, res.second);
+	}
+
+	/**
+	 * the targets applied of the submitted ones, e.g., "bootstrap = 30571/30612 (dropped 0)"
+	 */
+	std::string report() const {
+		return "bootstrap = " + std::to_string(applied) + "/" + std::to_string(submitted) + " (dropped " + std::to_string(dropped) + ")";
+	}
+
+	/**
+	 * the credit and the counters, for the training state of the player
+	 */
+	friend std::ostream& operator <<(std::ostream& out, const search_bootstrap& b) {
+		out.write(reinterpret_cast<const char*>(&b.credit), sizeof(b.credit));
+		size_t counters[] = { b.submitted, b.dropped, b.applied };
+		out.write(reinterpret_cast<const char*>(counters), sizeof(counters));
+		return out;
+	}
+	friend std::istream& operator >>(std::istream& in, search_bootstrap& b) {
+		in.read(reinterpret_cast<char*>(&b.credit), sizeof(b.credit));
+		size_t counters[3] = {};
+		in.read(reinterpret_cast<char*>(counters), sizeof(counters));
+		b.submitted = counters[0], b.dropped = counters[1], b.applied = counters[2];
+		return in;
+	}
+
+private:
+	float rate;
+	float credit;
+	size_t submitted, dropped, applied;
+	std::vector<bool> handed;
+	std::unique_ptr<async_pool<board::packed, target>> helpers;
+};
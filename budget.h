@@ -0,0 +1,128 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * budget.h: Allocation of a per-game search budget to the moves
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include "board.h"
+
+/**
+ * per-game budget of search effort, in milliseconds or in searched nodes, which is spent
+ * by iterative deepening: a move is searched to depth 1, 2, ... as long as the next depth is
+ * predicted (by the growth of the cost of the last depths) to fit in the allotment of the move;
+ * if results are reused across moves (see search_table), the last depths may have been cheap
+ * only because of the reuse, so the prediction is never below the average cost of the next depth
+ *
+ * the allotment is the remaining budget spread over the expected remaining moves (from the
+ * lengths of the previous games, or in the first game, as many moves as played so far but
+ * at least 32, so that the budget is spent up no matter how long the game turns out to be),
+ * scaled by the urgency of the board, which grows as the board
+ * fills up and as the largest tile grows; a move whose best two values are close is allowed
+ * twice its allotment, and a move with a single legal option is not searched deeper than 1
+ *
+ * the report would be
+ * budget = 97.2% of 2000 ms, depth = 2.41 (1:12.0%|2:35.1%|3:52.9%), moves = 4215/game
+ */
+class search_budget {
+public:
+	search_budget(double total = 0, const std::string& unit = "ms", unsigned limit = 4, float close = 0.02, bool reuse = false) :
+		total(total), unit(unit), limit(std::max(limit, 1u)), close(close), reuse(reuse), length(0), typical(1), remaining(total), played(0),
+		games(0), used(0), planned(0), searched(0), depths(limit + 1, 0), cost(limit + 2, 0) {}
+
+	bool enabled() const { return total > 0; }
+	unsigned max_depth() const { return limit; }
+
+	void open_game() {
+		remaining = total;
+		played = 0;
+	}
+	void close_game() {
+		if (!played) return;
+		games++;
+		length += (played - length) / std::min<double>(games, 16);
+		used += total - remaining;
+		planned += total;
+	}
+
+	/**
+	 * the effort allotted to the move of a board, where the urgency is relative to its running
+	 * average, so that the budget is not spent up before the critical moves at the end of a game;
+	 * a quarter of the expected length is always reserved for games longer than expected
+	 */
+	double allot(const board& before) {
+		unsigned empty = 0, tile = 0;
+		for (int i = 0; i < 16; i++) {
+			empty += before(i) == 0;
+			tile = std::max(tile, unsigned(before(i)));
+		}
+		double density = (16 - empty) / 16.0;
+		double urgency = (0.5 + 2 * density * density) * (1 + std::max(int(tile) - 10, 0) / 8.0);
+		typical += (urgency - typical) / 1024;
+		double expected = games ? length : std::max(2.0 * played, 64.0);
+		double moves = std::max({ expected - played, expected / 4, 10.0 });
+		return std::max(remaining, 0.0) / moves * urgency / typical;
+	}
+
+	/**
+	 * whether to search one more depth, given the cost of the last depth and of the one before,
+	 * the total cost of the move so far, and the best two values (reward plus value) of the move
+	 */
+	bool deepen(unsigned depth, double last, double previous, double spent, double allotted, float best, float second) {
+		cost[depth] += (last - cost[depth]) / 64;
+		if (depth >= limit) return false;
+		double growth = previous > 0 ? std::max(last / previous, 1.0) : 8;
+		bool tight = best - second <= close * std::abs(best);
+		double next = reuse ? std::max(last * growth, cost[depth + 1]) : last * growth;
+		return spent + next <= allotted * (tight ? 2 : 1);
+	}
+
+	void spend(double cost, unsigned depth) {
+		remaining -= cost;
+		played++;
+		searched++;
+		depths[std::min(depth, limit)]++;
+	}
+
+	std::string report() {
+		if (!enabled()) return "";
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(1);
+		ss << "budget = " << (planned ? used * 100 / planned : 0) << "% of " << std::setprecision(0) << total << " " << unit;
+		double sum = 0;
+		for (unsigned d = 1; d <= limit; d++) sum += double(d) * depths[d];
+		ss << ", depth = " << std::setprecision(2) << (searched ? sum / searched : 0) << " (";
+		ss << std::setprecision(1);
+		for (unsigned d = 1; d <= limit; d++) ss << (d > 1 ? "|" : "") << d << ":" << (searched ? depths[d] * 100.0 / searched : 0) << "%";
+		ss << "), moves = " << std::setprecision(0) << length << "/game";
+		used = planned = 0;
+		searched = 0;
+		std::fill(depths.begin(), depths.end(), 0);
+		return ss.str();
+	}
+
+private:
+	double total;
+	std::string unit;
+	unsigned limit;
+	float close;
+	bool reuse;
+	double length;
+	double typical;
+	double remaining;
+	size_t played;
+	size_t games;
+	double used, planned;
+	size_t searched;
+	std::vector<size_t> depths;
+	std::vector<double> cost;
+};
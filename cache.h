@@ -0,0 +1,156 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * cache.h: Per-thread caches of the values and the search results of afterstates
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <atomic>
+#include <cstring>
+#include "board.h"
+#include "memory.h"
+
+/**
+ * per-thread direct-mapped cache from afterstates to values
+ *
+ * an entry is only valid for the weights it was computed with, which are identified by
+ * a version drawn from a global counter whenever the weights of a player change;
+ * therefore entries of other players or of outdated weights never match
+ */
+class value_cache {
+public:
+	static value_cache& local() { static thread_local value_cache cache; return cache; }
+	static uint64_t version() { static std::atomic<uint64_t> counter(0); return ++counter; }
+
+	/**
+	 * make the cache n entries, where n is a power of two
+	 */
+	void resize(size_t n) {
+		if (slot.size() == n) return;
+		slot.assign(n, entry());
+		for (bits = 0; (size_t(1) << bits) < n; bits++);
+	}
+	void* data() { return slot.data(); }
+	size_t bytes() const { return slot.size() * sizeof(entry); }
+	bool find(const board::packed& b, uint64_t version, float& value) {
+		const entry& e = slot[b.hash(bits)];
+		lookups++;
+		if (e.version != version || std::memcmp(e.after.cell, b.cell, sizeof(b.cell)) != 0) return false;
+		hits++;
+		value = e.value;
+		return true;
+	}
+	void store(const board::packed& b, uint64_t version, float value) {
+		slot[b.hash(bits)] = { b, version, value };
+	}
+
+	/**
+	 * the hit rate since the last report, e.g., "cache = 31.6% of 8413284"
+	 */
+	std::string report() {
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(1);
+		ss << "cache = " << (lookups ? hits * 100.0 / lookups : 0) << "% of " << lookups;
+		hits = lookups = 0;
+		return ss.str();
+	}
+
+private:
+	value_cache() : bits(0), hits(0), lookups(0) {
+		memory::track("cache", this, [this]() { return slot.capacity() * sizeof(entry); });
+	}
+	~value_cache() { memory::untrack(this); }
+
+	struct entry {
+		board::packed after;
+		uint64_t version;
+		float value;
+		entry(const board::packed& after = {}, uint64_t version = 0, float value = 0) : after(after), version(version), value(value) {}
+	};
+	std::vector<entry> slot;
+	unsigned bits;
+	size_t hits, lookups;
+};
+
+/**
+ * per-thread transposition table from afterstates to their expected returns searched to
+ * some depth, which is kept across the moves of a game instead of cleared
+ *
+ * an entry answers a search of the same or a smaller depth with the same weights (see the
+ * versions of value_cache), and with the same or a larger slack, since a result searched with
+ * a slack may be off by that much (see forward_prune); entries are aged by the generation,
+ * which advances with each move, so that a slot is replaced by a result of the current move
+ * if its entry is from an earlier move or is not better, i.e., neither deeper nor searched
+ * to the same depth with less slack, and is kept otherwise
+ */
+class search_table {
+public:
+	static search_table& local() { static thread_local search_table table; return table; }
+
+	/**
+	 * start the search of a move in a table of n entries, where n is a power of two
+	 */
+	void age(size_t n) {
+		if (slot.size() != n) {
+			slot.assign(n, entry());
+			for (bits = 0; (size_t(1) << bits) < n; bits++);
+		}
+		generation++;
+	}
+
+	bool find(const board::packed& b, unsigned depth, float slack, uint64_t version, float& value) {
+		const entry& e = slot[b.hash(bits)];
+		probes++;
+		if (e.version != version || e.depth < depth || e.slack > slack || std::memcmp(e.after.cell, b.cell, sizeof(b.cell)) != 0) return false;
+		hits++;
+		reused += e.generation != generation;
+		value = e.value;
+		return true;
+	}
+	void store(const board::packed& b, unsigned depth, float slack, uint64_t version, float value) {
+		entry& e = slot[b.hash(bits)];
+		if (e.generation == generation && e.version == version && (e.depth > depth || (e.depth == depth && e.slack < slack))) return;
+		e = { b, version, value, slack, uint8_t(depth), generation };
+	}
+
+	/**
+	 * the hit rate since the last report, and the hits on results of earlier moves,
+	 * e.g., "table = 42.7% of 1204883 (reused 18.2%)"
+	 */
+	std::string report() {
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(1);
+		ss << "table = " << (probes ? hits * 100.0 / probes : 0) << "% of " << probes;
+		ss << " (reused " << (probes ? reused * 100.0 / probes : 0) << "%)";
+		hits = probes = reused = 0;
+		return ss.str();
+	}
+
+private:
+	search_table() : bits(0), generation(0), hits(0), probes(0), reused(0) {
+		memory::track("table", this, [this]() { return slot.capacity() * sizeof(entry); });
+	}
+	~search_table() { memory::untrack(this); }
+
+	struct entry {
+		board::packed after;
+		uint64_t version;
+		float value;
+		float slack;
+		uint8_t depth;
+		uint32_t generation;
+		entry(const board::packed& after = {}, uint64_t version = 0, float value = 0, float slack = 0, uint8_t depth = 0, uint32_t generation = 0) :
+			after(after), version(version), value(value), slack(slack), depth(depth), generation(generation) {}
+	};
+	std::vector<entry> slot;
+	unsigned bits;
+	uint32_t generation;
+	size_t hits, probes, reused;
+};
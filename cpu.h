@@ -0,0 +1,66 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * cpu.h: Runtime detection and selection of the instruction set used by the kernels
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+
+/**
+ * the kernels are compiled for every instruction set below, and the best one
+ * supported by the running cpu is selected once at startup
+ *
+ * generic: SSE2, the baseline of x86-64
+ * ssse3:   byte shuffles (pshufb)
+ * avx2:    256-bit shuffles and gathers
+ * avx512:  512-bit shuffles (AVX-512F and AVX-512BW)
+ */
+class cpu {
+public:
+	enum isa { generic, ssse3, avx2, avx512 };
+
+	static isa detect() {
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) return avx512;
+		if (__builtin_cpu_supports("avx2")) return avx2;
+		if (__builtin_cpu_supports("ssse3")) return ssse3;
+		return generic;
+	}
+
+	/**
+	 * the instruction set used by the kernels, which is the detected one by default
+	 */
+	static isa level() { return selected(); }
+
+	/**
+	 * force the kernels to use an instruction set, e.g., for benchmarking
+	 * return false if the name is unknown or the instruction set is not supported
+	 */
+	static bool select(const std::string& name) {
+		for (isa v : { generic, ssse3, avx2, avx512 }) {
+			if (name != cpu::name(v)) continue;
+			if (v > detect()) return false;
+			selected() = v;
+			return true;
+		}
+		if (name != "auto") return false;
+		selected() = detect();
+		return true;
+	}
+
+	static const char* name(isa v) {
+		switch (v) {
+		case ssse3:  return "ssse3";
+		case avx2:   return "avx2";
+		case avx512: return "avx512";
+		default:     return "generic";
+		}
+	}
+
+private:
+	static isa& selected() { static isa v = detect(); return v; }
+};
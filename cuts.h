@@ -0,0 +1,68 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * cuts.h: Fitted statistics for forward pruning of chance nodes
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+/**
+ * linear models of the deep values of states (before the move of the player) from their
+ * shallow values, i.e., search(s, d) ~ a * search(s, 1) + b with a residual deviation sigma,
+ * one model for each depth d, as fitted by cut_tuner
+ *
+ * the file has a model per line, e.g.,
+ * 2 1.0031 -12.7 85.2
+ * 3 1.0064 -20.4 121.9
+ */
+class cut_model {
+public:
+	struct line {
+		float a, b, sigma;
+		bool fitted;
+	};
+
+public:
+	cut_model(float z = 2) : z(z) {}
+
+	bool empty() const { return models.empty(); }
+	bool covers(unsigned depth) const { return depth < models.size() && models[depth].fitted; }
+	const line& at(unsigned depth) const { return models[depth]; }
+	float margin() const { return z; }
+	void margin(float v) { z = v; }
+
+	void fit(unsigned depth, float a, float b, float sigma) {
+		if (models.size() <= depth) models.resize(depth + 1, { 1, 0, 0, false });
+		models[depth] = { a, b, sigma, true };
+	}
+
+	bool load(const std::string& path) {
+		std::ifstream in(path);
+		if (!in.is_open()) return false;
+		for (std::string text; std::getline(in, text); ) {
+			std::stringstream ss(text);
+			unsigned depth;
+			float a, b, sigma;
+			if (ss >> depth >> a >> b >> sigma) fit(depth, a, b, sigma);
+		}
+		return !empty();
+	}
+	bool save(const std::string& path) const {
+		std::ofstream out(path, std::ios::out | std::ios::trunc);
+		if (!out.is_open()) return false;
+		for (unsigned d = 0; d < models.size(); d++)
+			if (models[d].fitted) out << d << " " << models[d].a << " " << models[d].b << " " << models[d].sigma << std::endl;
+		return true;
+	}
+
+private:
+	std::vector<line> models;
+	float z;
+};
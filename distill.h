@@ -0,0 +1,119 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * distill.h: Distillation of a large network into a smaller and faster one
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cmath>
+#include "board.h"
+#include "action.h"
+#include "agent.h"
+#include "episode.h"
+#include "parallel.h"
+#include "tool.h"
+
+/**
+ * distill the teacher into the student
+ *
+ * afterstates are sampled by worker threads, either from the self-play of the teacher
+ * or by replaying the episodes of a corpus (a file saved by --save), and labeled with the
+ * values of the teacher; the student is trained to match the labels one by one, since the
+ * afterstates of an episode share many features
+ *
+ * options are read from the student, e.g.,
+ * --distill="tuple=0123,4567 init alpha=0.1 save=small.bin games=10000 threads=4"
+ * --distill="tuple=0123,4567 init alpha=0.1 save=small.bin corpus=stat.txt"
+ */
+class distiller {
+public:
+	distiller(const player& teacher, player& student) : teacher(teacher), student(student),
+		games(tool::option(student, "games", size_t(1000))), threads(std::max<size_t>(tool::option(student, "threads", size_t(1)), 1)),
+		seed(tool::option(student, "seed", size_t(0))), corpus(tool::option(student, "corpus", std::string())) {}
+
+	void run() {
+		std::vector<std::string> episodes;
+		if (corpus.size()) {
+			std::ifstream in(corpus, std::ios::in);
+			for (std::string line; std::getline(in, line) && line.size(); ) episodes.push_back(line);
+			games = episodes.size();
+		}
+
+		channel<samples> queue(threads * 4);
+		std::thread producer([&]() {
+			tool::parallel(threads, [&](size_t id) {
+				if (episodes.size()) replay(id, episodes, queue);
+				else self_play(id, queue);
+			});
+			queue.close();
+		});
+
+		size_t count = 0;
+		double error = 0;
+		for (samples batch; queue.pop(batch); ) {
+			for (size_t i = 0; i < batch.after.size(); i++) {
+				error += std::pow(student.estimate_value(batch.after[i]) - batch.label[i], 2);
+				student.adjust_value(batch.after[i], batch.label[i]);
+			}
+			count += batch.after.size();
+		}
+		producer.join();
+
+		std::cout << "distill = " << games << " games, " << count << " samples, ";
+		std::cout << "rms = " << (count ? std::sqrt(error / count) : 0) << std::endl;
+	}
+
+protected:
+	/**
+	 * the afterstates of an episode and the values of the teacher
+	 */
+	struct samples {
+		std::vector<board> after;
+		std::vector<float> label;
+	};
+
+	void self_play(size_t id, channel<samples>& queue) {
+		for (size_t g = id; g < games; g += threads) {
+			samples batch;
+			tool::self_play(teacher, seed + g, nullptr, [&](const board&, const player::decision& move) {
+				if (move.op != -1) batch.after.push_back(move.after), batch.label.push_back(move.value);
+				return true;
+			});
+			queue.push(std::move(batch));
+		}
+	}
+
+	void replay(size_t id, const std::vector<std::string>& episodes, channel<samples>& queue) {
+		for (size_t g = id; g < episodes.size(); g += threads) {
+			episode game;
+			std::stringstream(episodes[g]) >> game;
+			samples batch;
+			board state;
+			for (const action& move : game.actions()) {
+				if (move.apply(state) == -1) break;
+				if (move.type() != action::slide::type) continue;
+				batch.after.push_back(state);
+			}
+			batch.label.resize(batch.after.size());
+			teacher.estimate_values(batch.after.data(), batch.after.size(), batch.label.data());
+			queue.push(std::move(batch));
+		}
+	}
+
+private:
+	const player& teacher;
+	player& student;
+	size_t games;
+	size_t threads;
+	size_t seed;
+	std::string corpus;
+};
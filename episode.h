@@ -31,6 +31,13 @@ public:
 	const board& state() const { return ep_state; }
 	board::reward score() const { return ep_score; }
 
+	/**
+	 * the bytes held by this episode, including the reserved moves
+	 */
+	size_t bytes() const {
+		return sizeof(episode) + ep_moves.capacity() * sizeof(move) + ep_open.tag.capacity() + ep_close.tag.capacity();
+	}
+
 	void open_episode(const std::string& tag) {
 		ep_open = { tag, millisec() };
 	}
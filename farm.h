@@ -0,0 +1,165 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * farm.h: Evaluation of all checkpoints of a training run in one process
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <glob.h>
+#include <sys/stat.h>
+#include "board.h"
+#include "agent.h"
+#include "tool.h"
+
+/**
+ * play a number of games with each checkpoint (weight files saved by save=) in a thread pool
+ *
+ * the checkpoints are given by a directory or a glob pattern, and are evaluated in the sorted
+ * order of their names; game g of every checkpoint uses the same environment seed, so that the
+ * checkpoints are compared on the same games
+ *
+ * each checkpoint is memory-mapped (map=) when its first game is scheduled and unmapped after
+ * its last game, and at most resident checkpoints are open at once; the other arguments of
+ * --play (e.g., tuple= or depth=) apply to all checkpoints, except load= and save=
+ *
+ * one CSV row is written per checkpoint, e.g.,
+ * --farm="checkpoints=snapshots/weights.*.bin games=1000 threads=8 resident=2 csv=curve.csv"
+ */
+class checkpoint_farm : public tool {
+public:
+	checkpoint_farm(const std::string& play_args, const std::string& args = "") :
+		tool("name=farm games=100 threads=1 resident=2 seed=0 " + args),
+		play_args(without(play_args, { "load", "save", "map" })), games(std::max(size_t(meta["games"]), size_t(1))),
+		threads(std::max(size_t(meta["threads"]), size_t(1))),
+		resident(std::max(size_t(meta["resident"]), size_t(1))), seed(meta["seed"]), next(0) {}
+
+	void run() {
+		if (meta.find("checkpoints") == meta.end()) std::exit(-1);
+		paths = expand(meta["checkpoints"]);
+		results.resize(paths.size());
+
+		std::ostream* csv = &std::cout;
+		std::ofstream file;
+		if (meta.find("csv") != meta.end()) {
+			file.open(meta["csv"], std::ios::out | std::ios::trunc);
+			if (!file.is_open()) std::exit(-1);
+			csv = &file;
+		}
+		*csv << "checkpoint,games,mean,stdev,max,max_tile,seconds" << std::endl;
+
+		parallel(threads, [this](size_t) { work(); });
+
+		for (size_t c = 0; c < paths.size(); c++) {
+			const summary& res = results[c];
+			double mean = res.sum / games;
+			double stdev = std::sqrt(std::max(res.sqsum / games - mean * mean, 0.0));
+			*csv << paths[c] << "," << games << "," << mean << "," << stdev << ",";
+			*csv << res.max << "," << board::fib(res.tile) << "," << res.seconds << std::endl;
+		}
+		std::cerr << "farm = " << paths.size() << " checkpoints, " << (paths.size() * games) << " games" << std::endl;
+	}
+
+protected:
+	struct summary {
+		double sum = 0, sqsum = 0, seconds = 0;
+		long max = 0;
+		unsigned tile = 0;
+	};
+	struct checkpoint {
+		size_t id;
+		std::unique_ptr<player> play;
+		size_t scheduled, finished;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	/**
+	 * take a game of an open checkpoint, or open the next checkpoint if there is room,
+	 * and wait otherwise, until all games of all checkpoints are finished
+	 */
+	void work() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			checkpoint* ckpt = nullptr;
+			for (auto& open : opened)
+				if (open->scheduled < games) { ckpt = open.get(); break; }
+			if (!ckpt && opened.size() < resident && next < paths.size()) {
+				opened.emplace_back(new checkpoint{ next, nullptr, 0, 0, std::chrono::steady_clock::now() });
+				opened.back()->play.reset(new player(play_args + " map=" + paths[next] + " alpha=0"));
+				ckpt = opened.back().get();
+				next++;
+			}
+			if (!ckpt) {
+				if (opened.empty() && next == paths.size()) break;
+				ready.wait(lock);
+				continue;
+			}
+
+			size_t g = ckpt->scheduled++;
+			lock.unlock();
+			unsigned tile = 0;
+			long score = self_play(*ckpt->play, seed + g, nullptr, [&](const board& state, const player::decision& move) {
+				for (int i = 0; i < 16 && move.op == -1; i++) tile = std::max(tile, unsigned(state(i)));
+				return true;
+			});
+			lock.lock();
+
+			summary& res = results[ckpt->id];
+			res.sum += score;
+			res.sqsum += double(score) * score;
+			res.max = std::max(res.max, score);
+			res.tile = std::max(res.tile, tile);
+			if (++ckpt->finished == games) {
+				res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - ckpt->start).count();
+				for (auto it = opened.begin(); it != opened.end(); it++)
+					if (it->get() == ckpt) { opened.erase(it); break; }
+				ready.notify_all();
+			}
+		}
+		ready.notify_all();
+	}
+
+	/**
+	 * the sorted paths of a directory or a glob pattern
+	 */
+	static std::vector<std::string> expand(std::string pattern) {
+		struct stat st;
+		if (stat(pattern.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) pattern += "/*";
+		std::vector<std::string> res;
+		glob_t matches;
+		if (glob(pattern.c_str(), 0, nullptr, &matches) == 0) {
+			for (size_t i = 0; i < matches.gl_pathc; i++) {
+				if (stat(matches.gl_pathv[i], &st) == 0 && S_ISREG(st.st_mode)) res.push_back(matches.gl_pathv[i]);
+			}
+		}
+		globfree(&matches);
+		return res;
+	}
+
+private:
+	std::string play_args;
+	size_t games;
+	size_t threads;
+	size_t resident;
+	size_t seed;
+	std::vector<std::string> paths;
+	std::vector<summary> results;
+	std::vector<std::unique_ptr<checkpoint>> opened;
+	size_t next;
+	std::mutex mutex;
+	std::condition_variable ready;
+};
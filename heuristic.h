@@ -0,0 +1,86 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * heuristic.h: Table-driven heuristic evaluation of boards
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "board.h"
+#include "memory.h"
+
+/**
+ * hand-crafted evaluation of a board as the sum of the scores of its 4 rows and 4 columns,
+ * which are precomputed for all lines of 4 tiles, i.e., 8 table lookups per board
+ *
+ * the score of a line rewards empty cells and pairs of neighboring tiles (ignoring the empty
+ * cells between them) that can merge, i.e., adjacent Fibonacci numbers or two 1-tiles, and
+ * penalizes lines that are not monotonic, by the smaller of the total rises and the total
+ * falls of the tile indices along the line
+ *
+ * the table has 2^20 entries indexed by 5 bits per tile, i.e., tiles up to 31
+ */
+class heuristic {
+public:
+	static constexpr float empty = 2, merge = 3, monotonic = 1;
+
+	/**
+	 * the heuristic of a board or a packed board
+	 */
+	template<typename grid>
+	static float evaluate(const grid& b) {
+		const float* score = lines().score.data();
+		float value = 0;
+		for (unsigned i = 0; i < 4; i++) {
+			value += score[key(b(i * 4), b(i * 4 + 1), b(i * 4 + 2), b(i * 4 + 3))];
+			value += score[key(b(i), b(i + 4), b(i + 8), b(i + 12))];
+		}
+		return value;
+	}
+
+	/**
+	 * the score of a line of 4 tiles
+	 */
+	static float line(const uint32_t t[4]) {
+		float value = 0;
+		uint32_t tile[4];
+		unsigned n = 0;
+		for (unsigned j = 0; j < 4; j++) {
+			if (t[j]) tile[n++] = t[j];
+			else value += empty;
+		}
+		for (unsigned j = 1; j < n; j++) {
+			uint32_t a = tile[j - 1], b = tile[j];
+			if ((a == 1 && b == 1) || a + 1 == b || b + 1 == a) value += merge;
+		}
+		float rise = 0, fall = 0;
+		for (unsigned j = 1; j < 4; j++) {
+			if (t[j] > t[j - 1]) rise += t[j] - t[j - 1];
+			else fall += t[j - 1] - t[j];
+		}
+		return value - monotonic * std::min(rise, fall);
+	}
+
+private:
+	static uint32_t key(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+		return a | (b << 5) | (c << 10) | (d << 15);
+	}
+
+	struct table {
+		std::vector<float> score;
+		table() : score(1 << 20) {
+			for (uint32_t k = 0; k < score.size(); k++) {
+				uint32_t t[4] = { k & 31, (k >> 5) & 31, (k >> 10) & 31, (k >> 15) & 31 };
+				score[k] = line(t);
+			}
+			memory::track("heuristic", this, [this]() { return score.capacity() * sizeof(float); });
+		}
+		~table() { memory::untrack(this); }
+	};
+	static const table& lines() { static const table t; return t; }
+};
@@ -0,0 +1,142 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * memory.h: Accounting of the memory footprint of each subsystem
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/**
+ * subsystems register a probe returning the bytes they currently hold,
+ * probes with the same name (e.g., players of different threads) are summed up in reports
+ *
+ * the footprint report would be
+ * mem = 117.2M (net 117.2M, history 32.0K, statistic 15.3M), rss = 134.6M, peak = 134.9M
+ */
+class memory {
+public:
+	typedef std::function<size_t()> probe;
+
+	static void track(const std::string& name, const void* owner, probe bytes) {
+		std::lock_guard<std::mutex> lock(registry().mutex);
+		registry().entries.push_back({ name, owner, bytes });
+	}
+	static void untrack(const void* owner) {
+		std::lock_guard<std::mutex> lock(registry().mutex);
+		auto& entries = registry().entries;
+		for (auto it = entries.begin(); it != entries.end(); )
+			it = (it->owner == owner) ? entries.erase(it) : it + 1;
+	}
+
+	/**
+	 * the bytes held by each subsystem, in the order of registration
+	 */
+	static std::vector<std::pair<std::string, size_t>> usage() {
+		std::lock_guard<std::mutex> lock(registry().mutex);
+		std::vector<std::pair<std::string, size_t>> res;
+		for (const entry& e : registry().entries) {
+			auto it = res.begin();
+			while (it != res.end() && it->first != e.name) it++;
+			if (it == res.end()) it = res.insert(res.end(), { e.name, 0 });
+			it->second += e.bytes();
+		}
+		return res;
+	}
+
+	/**
+	 * the current and the peak resident set size, read from /proc/self/status
+	 * return 0 if not available
+	 */
+	static size_t rss() { return status("VmRSS:"); }
+	static size_t peak() { return status("VmHWM:"); }
+
+	static std::string footprint() {
+		std::stringstream ss, detail;
+		size_t total = 0;
+		for (auto& u : usage()) {
+			if (detail.str().size()) detail << ", ";
+			detail << u.first << " " << human(u.second);
+			total += u.second;
+		}
+		ss << "mem = " << human(total) << " (" << detail.str() << "), ";
+		ss << "rss = " << human(rss()) << ", peak = " << human(peak());
+		return ss.str();
+	}
+
+	/**
+	 * fault in the pages of a region by touching a byte of each page in parallel threads,
+	 * with writes if the region will be written, so that later accesses never fault;
+	 * then lock the pages in memory if requested
+	 * the touched bytes are always within the region, as the first page may start before it
+	 * (with other objects that may be in use), while the locked range is page-aligned
+	 * return false if they cannot be locked, e.g., beyond RLIMIT_MEMLOCK
+	 */
+	static bool prefault(const void* ptr, size_t bytes, bool writable, bool lock, size_t threads = 0) {
+		if (!ptr || !bytes) return true;
+		size_t page = sysconf(_SC_PAGESIZE);
+		char* first = static_cast<char*>(const_cast<void*>(ptr));
+		char* begin = reinterpret_cast<char*>(uintptr_t(ptr) / page * page);
+		size_t pages = (static_cast<const char*>(ptr) + bytes - begin + page - 1) / page;
+		if (!threads) threads = std::max(std::thread::hardware_concurrency(), 1u);
+		threads = std::max<size_t>(std::min(threads, pages / 256), 1);
+		auto touch = [=](size_t id) {
+			for (size_t i = id; i < pages; i += threads) {
+				volatile char* p = std::max(begin + i * page, first);
+				if (writable) *p = *p;
+				else (void)*p;
+			}
+		};
+		std::vector<std::thread> workers;
+		for (size_t id = 1; id < threads; id++) workers.emplace_back(touch, id);
+		touch(0);
+		for (std::thread& worker : workers) worker.join();
+		return !lock || mlock(begin, pages * page) == 0;
+	}
+
+	static std::string human(size_t bytes) {
+		const char* unit = "BKMGT";
+		double value = bytes;
+		while (value >= 1024 && unit[1]) value /= 1024, unit++;
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(*unit == 'B' ? 0 : 1) << value << (*unit == 'B' ? "" : std::string(1, *unit));
+		return ss.str();
+	}
+
+private:
+	struct entry {
+		std::string name;
+		const void* owner;
+		probe bytes;
+	};
+	struct table {
+		std::vector<entry> entries;
+		std::mutex mutex;
+	};
+	static table& registry() { static table t; return t; }
+
+	static size_t status(const std::string& key) {
+		std::ifstream in("/proc/self/status");
+		for (std::string line; std::getline(in, line); ) {
+			if (line.find(key) != 0) continue;
+			size_t kb = 0;
+			std::stringstream(line.substr(key.size())) >> kb;
+			return kb * 1024;
+		}
+		return 0;
+	}
+};
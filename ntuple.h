@@ -0,0 +1,432 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * ntuple.h: Feature extraction of n-tuple network, with compile-time and runtime patterns
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdint>
+#include <algorithm>
+#include <immintrin.h>
+#include "board.h"
+#include "weight.h"
+#include "cpu.h"
+
+/**
+ * the 8 isomorphisms of the board
+ *
+ * isomorphism s is the board rotated clockwise (s + 1) times for s < 4,
+ * or the horizontal reflection rotated clockwise (s - 3) times for s >= 4,
+ * which is the order visited by rotate_right() and reflect_horizontal()
+ *
+ * source(s, p) is the cell of the original board that appears at p in isomorphism s
+ */
+struct isomorphism {
+	static constexpr unsigned count = 8;
+	static constexpr unsigned rotate(unsigned p) { return (3 - p % 4) * 4 + p / 4; }
+	static constexpr unsigned reflect(unsigned p) { return (p / 4) * 4 + (3 - p % 4); }
+	static constexpr unsigned rotate(unsigned p, unsigned n) { return n ? rotate(rotate(p), n - 1) : p; }
+	static constexpr unsigned source(unsigned s, unsigned p) { return s < 4 ? rotate(p, s + 1) : reflect(rotate(p, s - 3)); }
+
+	/**
+	 * the move (0-3: up, right, down, left) in isomorphism s that is equivalent to move op of the original,
+	 * and the inverse mapping
+	 */
+	static constexpr unsigned turns(unsigned s) { return (s < 4 ? s + 1 : s - 3) % 4; }
+	static constexpr unsigned mirror(unsigned s, unsigned op) { return (s >= 4 && op % 2) ? op ^ 2 : op; }
+	static constexpr unsigned move(unsigned s, unsigned op) { return (mirror(s, op) + turns(s)) % 4; }
+	static constexpr unsigned unmove(unsigned s, unsigned op) { return mirror(s, (op + 4 - turns(s)) % 4); }
+};
+
+/**
+ * the number of possible values of a cell, i.e., the radix of a feature index
+ */
+constexpr size_t tuple_radix = 25;
+constexpr size_t tuple_length(unsigned n) { return n ? tuple_radix * tuple_length(n - 1) : 1; }
+
+/**
+ * compile-time n-tuple pattern, e.g., pattern<0, 1, 2, 3, 4>
+ * the symmetric cells of all isomorphisms are generated as a constexpr table
+ */
+template<unsigned... cells>
+struct pattern {
+	static constexpr unsigned size = sizeof...(cells);
+	static constexpr size_t length = tuple_length(size);
+	alignas(64) static constexpr uint8_t cell[isomorphism::count][size] = {
+		{ isomorphism::source(0, cells)... }, { isomorphism::source(1, cells)... },
+		{ isomorphism::source(2, cells)... }, { isomorphism::source(3, cells)... },
+		{ isomorphism::source(4, cells)... }, { isomorphism::source(5, cells)... },
+		{ isomorphism::source(6, cells)... }, { isomorphism::source(7, cells)... },
+	};
+	/**
+	 * the symmetric cells transposed for byte shuffles, i.e., gather[i][s] = cell[s][i]
+	 */
+	alignas(16) static constexpr uint8_t gather[size][16] = {
+		{ isomorphism::source(0, cells), isomorphism::source(1, cells), isomorphism::source(2, cells), isomorphism::source(3, cells),
+		  isomorphism::source(4, cells), isomorphism::source(5, cells), isomorphism::source(6, cells), isomorphism::source(7, cells),
+		  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 }...
+	};
+
+	static std::vector<unsigned> topology() { return { cells... }; }
+
+	static size_t index(const board& b, unsigned s) {
+		size_t idx = 0;
+		for (unsigned i = 0; i < size; i++) idx = idx * tuple_radix + b(cell[s][i]);
+		return idx;
+	}
+	/**
+	 * the index of an isomorphism that has already been permuted, see isomorphisms()
+	 */
+	static size_t index(const board::packed& iso) {
+		const unsigned tuple[] = { cells... };
+		size_t idx = 0;
+		for (unsigned i = 0; i < size; i++) idx = idx * tuple_radix + iso(tuple[i]);
+		return idx;
+	}
+	static float estimate(const weight& w, const board::packed* iso) {
+		float value = 0;
+		for (unsigned s = 0; s < isomorphism::count; s++) value += w[index(iso[s])];
+		return value;
+	}
+	static void update(weight& w, const board::packed* iso, float u) {
+		for (unsigned s = 0; s < isomorphism::count; s++) w[index(iso[s])] += u;
+	}
+	static void index(const board::packed* iso, uint32_t* idx) {
+		for (unsigned s = 0; s < isomorphism::count; s++) idx[s] = index(iso[s]);
+	}
+
+	/**
+	 * the indices of all isomorphisms in 8 lanes, gathered directly from the packed board
+	 * by one byte shuffle per cell of the tuple
+	 */
+	__attribute__((target("avx2")))
+	static __m256i index(__m128i b) {
+		static_assert(length <= 0x7fffffff, "the indices must fit in 32-bit lanes");
+		const __m256i radix = _mm256_set1_epi32(tuple_radix);
+		__m256i idx = _mm256_setzero_si256();
+		for (unsigned i = 0; i < size; i++) {
+			__m128i t = _mm_shuffle_epi8(b, _mm_load_si128(reinterpret_cast<const __m128i*>(gather[i])));
+			idx = _mm256_add_epi32(_mm256_mullo_epi32(idx, radix), _mm256_cvtepu8_epi32(t));
+		}
+		return idx;
+	}
+	__attribute__((target("avx2")))
+	static __m256 lookup(const weight& w, __m128i b) {
+		return _mm256_i32gather_ps(w.data(), index(b), sizeof(weight::type));
+	}
+};
+
+template<unsigned... cells>
+constexpr uint8_t pattern<cells...>::cell[isomorphism::count][pattern<cells...>::size];
+template<unsigned... cells>
+constexpr uint8_t pattern<cells...>::gather[pattern<cells...>::size][16];
+
+/**
+ * generate all isomorphisms of a board at once
+ *
+ * with the tiles packed as bytes in a 128-bit register, each isomorphism is a single byte shuffle,
+ * whose control mask is the symmetric cells of the whole board
+ */
+typedef pattern<0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15> whole_board;
+
+inline void isomorphisms_generic(const board::packed& b, board::packed* iso) {
+	for (unsigned s = 0; s < isomorphism::count; s++)
+		for (unsigned p = 0; p < 16; p++) iso[s](p) = b(whole_board::cell[s][p]);
+}
+
+__attribute__((target("ssse3")))
+inline void isomorphisms_ssse3(const board::packed& b, board::packed* iso) {
+	__m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(b.cell));
+	for (unsigned s = 0; s < isomorphism::count; s++) {
+		__m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(whole_board::cell[s]));
+		_mm_store_si128(reinterpret_cast<__m128i*>(iso[s].cell), _mm_shuffle_epi8(v, mask));
+	}
+}
+
+__attribute__((target("avx2")))
+inline void isomorphisms_avx2(const board::packed& b, board::packed* iso) {
+	__m256i v = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(b.cell)));
+	for (unsigned s = 0; s < isomorphism::count; s += 2) {
+		__m256i mask = _mm256_load_si256(reinterpret_cast<const __m256i*>(whole_board::cell[s]));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(iso[s].cell), _mm256_shuffle_epi8(v, mask));
+	}
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline void isomorphisms_avx512(const board::packed& b, board::packed* iso) {
+	__m512i v = _mm512_maskz_broadcast_i32x4(0xffff, _mm_load_si128(reinterpret_cast<const __m128i*>(b.cell)));
+	for (unsigned s = 0; s < isomorphism::count; s += 4) {
+		__m512i mask = _mm512_load_si512(whole_board::cell[s]);
+		_mm512_storeu_si512(iso[s].cell, _mm512_shuffle_epi8(v, mask));
+	}
+}
+
+inline void isomorphisms(const board::packed& b, board::packed* iso) {
+	switch (cpu::level()) {
+	case cpu::avx512: return isomorphisms_avx512(b, iso);
+	case cpu::avx2:   return isomorphisms_avx2(b, iso);
+	case cpu::ssse3:  return isomorphisms_ssse3(b, iso);
+	default:          return isomorphisms_generic(b, iso);
+	}
+}
+
+/**
+ * compile-time n-tuple network, e.g., ntuple_network<pattern<0, 1, 2, 3, 4>, pattern<4, 5, 6, 7, 8>>
+ * evaluation and update are fully unrolled over the patterns and isomorphisms
+ *
+ * with AVX2, the indices of all isomorphisms of a pattern are computed in one register
+ * and the weights are fetched by a single gather, without generating the isomorphisms
+ *
+ * the network does not own the weights, net[i] is the lookup table of the i-th pattern
+ */
+template<typename... patterns>
+struct ntuple_network;
+
+template<>
+struct ntuple_network<> {
+	static constexpr size_t tables = 0;
+	static void topology(std::vector<std::vector<unsigned>>& res) {}
+	static bool match(const weight* net) { return true; }
+	static float estimate(const weight* net, const board::packed* iso) { return 0; }
+	static void update(weight* net, const board::packed* iso, float u) {}
+	static void index(const board::packed* iso, uint32_t* idx) {}
+	__attribute__((target("avx2")))
+	static __m256 lookup(const weight* net, __m128i b) { return _mm256_setzero_ps(); }
+	__attribute__((target("avx2")))
+	static void index(__m128i b, uint32_t* idx) {}
+};
+
+template<typename head, typename... tail>
+struct ntuple_network<head, tail...> {
+	typedef ntuple_network<tail...> rest;
+	static constexpr size_t tables = 1 + rest::tables;
+
+	static std::vector<std::vector<unsigned>> topology() {
+		std::vector<std::vector<unsigned>> res;
+		topology(res);
+		return res;
+	}
+	static void topology(std::vector<std::vector<unsigned>>& res) {
+		res.push_back(head::topology());
+		rest::topology(res);
+	}
+	static bool match(const weight* net) {
+		return net[0].size() == head::length && rest::match(net + 1);
+	}
+	static float estimate(const weight* net, const board& b) { return estimate(net, b.pack()); }
+	static void update(weight* net, const board& b, float u) { update(net, b.pack(), u); }
+	static void index(const board& b, uint32_t* idx) { index(b.pack(), idx); }
+
+	static float estimate(const weight* net, const board::packed& b) {
+		switch (cpu::level()) {
+		case cpu::avx512:
+		case cpu::avx2:
+			return estimate_avx2(net, b);
+		default:
+			board::packed iso[isomorphism::count];
+			isomorphisms(b, iso);
+			return estimate(net, iso);
+		}
+	}
+	static void update(weight* net, const board::packed& b, float u) {
+		uint32_t idx[tables * isomorphism::count];
+		index(b, idx);
+		for (size_t i = 0; i < tables; i++)
+			for (unsigned s = 0; s < isomorphism::count; s++)
+				net[i][idx[i * isomorphism::count + s]] += u;
+	}
+	static void index(const board::packed& b, uint32_t* idx) {
+		switch (cpu::level()) {
+		case cpu::avx512:
+		case cpu::avx2:
+			return index_avx2(b, idx);
+		default:
+			board::packed iso[isomorphism::count];
+			isomorphisms(b, iso);
+			return index(iso, idx);
+		}
+	}
+	static float estimate(const weight* net, const board::packed* iso) {
+		return head::estimate(net[0], iso) + rest::estimate(net + 1, iso);
+	}
+	static void update(weight* net, const board::packed* iso, float u) {
+		head::update(net[0], iso, u);
+		rest::update(net + 1, iso, u);
+	}
+	/**
+	 * the feature indices of all patterns, isomorphism::count indices per pattern
+	 */
+	static void index(const board::packed* iso, uint32_t* idx) {
+		head::index(iso, idx);
+		rest::index(iso, idx + isomorphism::count);
+	}
+
+	__attribute__((target("avx2")))
+	static __m256 lookup(const weight* net, __m128i b) {
+		return _mm256_add_ps(head::lookup(net[0], b), rest::lookup(net + 1, b));
+	}
+	__attribute__((target("avx2")))
+	static void index(__m128i b, uint32_t* idx) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(idx), head::index(b));
+		rest::index(b, idx + isomorphism::count);
+	}
+	__attribute__((target("avx2")))
+	static float estimate_avx2(const weight* net, const board::packed& b) {
+		__m256 v = lookup(net, _mm_load_si128(reinterpret_cast<const __m128i*>(b.cell)));
+		__m128 h = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+		h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+		h = _mm_add_ss(h, _mm_movehdup_ps(h));
+		return _mm_cvtss_f32(h);
+	}
+	__attribute__((target("avx2")))
+	static void index_avx2(const board::packed& b, uint32_t* idx) {
+		index(_mm_load_si128(reinterpret_cast<const __m128i*>(b.cell)), idx);
+	}
+};
+
+/**
+ * runtime n-tuple pattern, the fallback for topologies without a specialized network
+ */
+class ntuple {
+public:
+	ntuple(const std::vector<unsigned>& cells = {}) : cells(cells), cell(isomorphism::count, cells) {
+		for (unsigned s = 0; s < isomorphism::count; s++)
+			for (size_t i = 0; i < cells.size(); i++)
+				cell[s][i] = isomorphism::source(s, cells[i]);
+	}
+
+	const std::vector<unsigned>& topology() const { return cells; }
+	size_t size() const { return cells.size(); }
+	size_t length() const { return tuple_length(cells.size()); }
+
+	size_t index(const board& b, unsigned s) const {
+		size_t idx = 0;
+		for (unsigned p : cell[s]) idx = idx * tuple_radix + b(p);
+		return idx;
+	}
+	size_t index(const board::packed& iso) const {
+		size_t idx = 0;
+		for (unsigned p : cells) idx = idx * tuple_radix + iso(p);
+		return idx;
+	}
+	float estimate(const weight& w, const board::packed* iso) const {
+		float value = 0;
+		for (unsigned s = 0; s < isomorphism::count; s++) value += w[index(iso[s])];
+		return value;
+	}
+	void update(weight& w, const board::packed* iso, float u) const {
+		for (unsigned s = 0; s < isomorphism::count; s++) w[index(iso[s])] += u;
+	}
+	void index(const board::packed* iso, uint32_t* idx) const {
+		for (unsigned s = 0; s < isomorphism::count; s++) idx[s] = index(iso[s]);
+	}
+
+	/**
+	 * parse patterns from a string, one hex digit per cell and separated by commas
+	 * e.g., "01234,45678,01245"
+	 */
+	static std::vector<ntuple> parse(const std::string& spec) {
+		std::vector<ntuple> res;
+		std::stringstream ss(spec);
+		for (std::string token; std::getline(ss, token, ','); ) {
+			std::vector<unsigned> cells;
+			for (char c : token) cells.push_back(std::stoul(std::string(1, c), nullptr, 16));
+			if (cells.size()) res.emplace_back(cells);
+		}
+		return res;
+	}
+
+private:
+	std::vector<unsigned> cells;
+	std::vector<std::vector<unsigned>> cell;
+};
+
+/**
+ * the contributions of each cell to the feature indices, for updating the indices incrementally
+ * instead of computing them from scratch when only a few cells of a board change
+ *
+ * a tile t at cell p adds t * radix(p, f) to feature index f, where radix(p, f) is the place value
+ * of p in the (tuple, symmetry) of f, or 0 if it does not read p; the index of (tuple i, symmetry s)
+ * is f = i * isomorphism::count + s as in the feature indices of the player
+ *
+ * the radixes of a cell are stored densely, so that an update is a short vectorizable loop
+ * over all features rather than a chain of scattered read-modify-writes
+ */
+class feature_cells {
+public:
+	feature_cells(const std::vector<ntuple>& tuples = {}) : features(tuples.size() * isomorphism::count), radix(16 * features) {
+		for (size_t i = 0; i < tuples.size(); i++) {
+			const std::vector<unsigned>& cells = tuples[i].topology();
+			for (unsigned s = 0; s < isomorphism::count; s++) {
+				uint32_t place = 1;
+				for (size_t k = cells.size(); k-- > 0; place *= tuple_radix)
+					radix[isomorphism::source(s, cells[k]) * features + i * isomorphism::count + s] = place;
+			}
+		}
+	}
+
+	/**
+	 * update the indices for the tile at cell p changed from one value to another
+	 */
+	void update(uint32_t* index, unsigned p, unsigned from, unsigned to) const {
+		const uint32_t delta = to - from;
+		const uint32_t* place = radix.data() + p * features;
+		for (size_t f = 0; f < features; f++) index[f] += delta * place[f];
+	}
+
+	/**
+	 * the indices of board b from the indices of board a, only over the cells that differ
+	 * the indices of b are written to out, which may be the same as index
+	 */
+	void update(const uint32_t* index, uint32_t* out, const board::packed& a, const board::packed& b) const {
+#if defined(__SSE2__)
+		__m128i va = _mm_load_si128(reinterpret_cast<const __m128i*>(a.cell));
+		__m128i vb = _mm_load_si128(reinterpret_cast<const __m128i*>(b.cell));
+		unsigned diff = ~_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) & 0xffff;
+		if (cpu::level() >= cpu::avx2) return update_avx2(index, out, a, b, diff);
+#else
+		unsigned diff = 0;
+		for (unsigned p = 0; p < 16; p++) diff |= unsigned(a(p) != b(p)) << p;
+#endif
+		if (out != index) std::copy(index, index + features, out);
+		for (; diff; diff &= diff - 1) {
+			unsigned p = __builtin_ctz(diff);
+			update(out, p, a(p), b(p));
+		}
+	}
+
+protected:
+#if defined(__SSE2__)
+	/**
+	 * 8 features per register (the features are a multiple of isomorphism::count),
+	 * each register of indices is loaded once and updated by all changed cells
+	 */
+	__attribute__((target("avx2")))
+	void update_avx2(const uint32_t* index, uint32_t* out, const board::packed& a, const board::packed& b, unsigned diff) const {
+		__m256i delta[16];
+		const uint32_t* place[16];
+		unsigned n = 0;
+		for (; diff; diff &= diff - 1, n++) {
+			unsigned p = __builtin_ctz(diff);
+			delta[n] = _mm256_set1_epi32(int(b(p)) - int(a(p)));
+			place[n] = radix.data() + p * features;
+		}
+		for (size_t f = 0; f < features; f += 8) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index + f));
+			for (unsigned i = 0; i < n; i++)
+				v = _mm256_add_epi32(v, _mm256_mullo_epi32(delta[i], _mm256_loadu_si256(reinterpret_cast<const __m256i*>(place[i] + f))));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + f), v);
+		}
+	}
+#endif
+
+private:
+	size_t features;
+	std::vector<uint32_t> radix;
+};
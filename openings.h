@@ -0,0 +1,80 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * openings.h: Offline builder of the opening book by deep search
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "board.h"
+#include "agent.h"
+#include "book.h"
+#include "tool.h"
+
+/**
+ * collect the canonical states before the first moves of the self-play of a player,
+ * search each of them to a deep depth in parallel threads, and save them as a book
+ *
+ * options, e.g.,
+ * --book="games=10000 moves=32 depth=3 threads=4 save=book.bin"
+ */
+class book_builder : public tool {
+public:
+	book_builder(const player& play, const std::string& args = "") : tool("name=book games=1000 moves=32 depth=3 threads=1 seed=0 " + args),
+		play(play), games(meta["games"]), moves(meta["moves"]), depth(std::max(int(meta["depth"]), 1)),
+		threads(std::max(size_t(meta["threads"]), size_t(1))), seed(meta["seed"]) {}
+
+	void run() {
+		std::vector<board::packed> states = collect();
+
+		std::vector<opening_book::entry> entries(states.size());
+		parallel_for(threads, states.size(), [&](size_t i) {
+			play.begin_search();
+			player::decision move = play.search(board(states[i]), depth);
+			entries[i] = { states[i], move.value, move.op };
+		});
+		entries.erase(std::remove_if(entries.begin(), entries.end(),
+			[](const opening_book::entry& e) { return e.op == -1; }), entries.end());
+
+		std::cout << "book = " << games << " games, " << entries.size() << " positions, depth = " << depth << std::endl;
+		if (meta.find("save") != meta.end() && !opening_book::save(meta["save"], entries))
+			std::exit(-1);
+	}
+
+protected:
+	/**
+	 * the distinct canonical states before the first moves of the greedy self-play
+	 */
+	std::vector<board::packed> collect() const {
+		std::vector<board::packed> states;
+		for (size_t g = 0; g < games; g++) {
+			size_t n = 0;
+			self_play(play, seed + g, nullptr, [&](const board& state, const player::decision&) {
+				if (n++ == moves) return false;
+				unsigned s;
+				states.push_back(opening_book::canonical(state.pack(), s));
+				return true;
+			});
+		}
+		auto less = [](const board::packed& a, const board::packed& b) { return std::memcmp(a.cell, b.cell, sizeof(a.cell)) < 0; };
+		auto equal = [](const board::packed& a, const board::packed& b) { return std::memcmp(a.cell, b.cell, sizeof(a.cell)) == 0; };
+		std::sort(states.begin(), states.end(), less);
+		states.erase(std::unique(states.begin(), states.end(), equal), states.end());
+		return states;
+	}
+
+private:
+	const player& play;
+	size_t games;
+	size_t moves;
+	unsigned depth;
+	size_t threads;
+	size_t seed;
+};
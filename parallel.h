@@ -0,0 +1,183 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * parallel.h: Utilities for running agents in parallel threads
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <utility>
+
+/**
+ * bounded blocking queue between producer and consumer threads
+ * pop() returns false once the channel is closed and drained
+ */
+template<typename item>
+class channel {
+public:
+	channel(size_t capacity = 64) : capacity(capacity), closed(false) {}
+
+	void push(item&& v) {
+		std::unique_lock<std::mutex> lock(mutex);
+		not_full.wait(lock, [this]() { return queue.size() < capacity || closed; });
+		queue.push_back(std::move(v));
+		not_empty.notify_one();
+	}
+	/**
+	 * push without blocking, return false if the channel is full or closed
+	 */
+	bool try_push(item&& v) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (queue.size() >= capacity || closed) return false;
+		queue.push_back(std::move(v));
+		not_empty.notify_one();
+		return true;
+	}
+	bool pop(item& v) {
+		std::unique_lock<std::mutex> lock(mutex);
+		not_empty.wait(lock, [this]() { return queue.size() || closed; });
+		if (queue.empty()) return false;
+		v = std::move(queue.front());
+		queue.pop_front();
+		not_full.notify_one();
+		return true;
+	}
+	/**
+	 * pop without blocking, return false if the channel is empty
+	 */
+	bool try_pop(item& v) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (queue.empty()) return false;
+		v = std::move(queue.front());
+		queue.pop_front();
+		not_full.notify_one();
+		return true;
+	}
+	void close() {
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		not_empty.notify_all();
+		not_full.notify_all();
+	}
+
+private:
+	std::deque<item> queue;
+	size_t capacity;
+	bool closed;
+	std::mutex mutex;
+	std::condition_variable not_empty;
+	std::condition_variable not_full;
+};
+
+/**
+ * worker threads computing results of tasks in the background
+ * tasks are dropped instead of blocking the caller when the workers fall behind,
+ * and the results are collected whenever the caller is ready for them
+ */
+template<typename task, typename result>
+class async_pool {
+public:
+	async_pool(size_t threads, std::function<result(const task&)> work, size_t capacity = 1024) :
+		tasks(capacity), results(size_t(-1)), work(work) {
+		for (size_t id = 0; id < threads; id++) {
+			workers.emplace_back([this]() {
+				for (task t; tasks.pop(t); ) results.push(this->work(t));
+			});
+		}
+	}
+	~async_pool() { stop(); }
+
+	bool submit(task&& t) { return tasks.try_push(std::move(t)); }
+	bool poll(result& r) { return results.try_pop(r); }
+
+	/**
+	 * finish the submitted tasks and join the workers, the results remain available by poll()
+	 */
+	void stop() {
+		tasks.close();
+		for (std::thread& worker : workers) worker.join();
+		workers.clear();
+	}
+
+private:
+	channel<task> tasks;
+	channel<result> results;
+	std::function<result(const task&)> work;
+	std::vector<std::thread> workers;
+};
+
+/**
+ * an object published to reader threads, which can be replaced while they are reading it
+ * the replaced object is returned to the writer, who reclaims it after the readers leave, see epochs
+ */
+template<typename type>
+class published {
+public:
+	published(type* v = new type()) : ptr(v) {}
+	published(const published&) = delete;
+	published& operator =(const published&) = delete;
+	~published() { delete ptr.load(); }
+
+	type* get() const { return ptr.load(std::memory_order_acquire); }
+	type& operator *() const { return *get(); }
+	type* operator ->() const { return get(); }
+	type* exchange(type* v) { return ptr.exchange(v, std::memory_order_acq_rel); }
+
+private:
+	std::atomic<type*> ptr;
+};
+
+/**
+ * epoch-based reclamation for published objects
+ *
+ * readers enter a read-side section for each request, and are counted in the parity of the epoch
+ * they entered; after replacing an object, synchronize() advances the epoch and waits until the
+ * sections of the previous epoch have left, so that the replaced object can be deleted safely
+ * readers never wait, only the writer does
+ */
+class epochs {
+public:
+	epochs() : epoch(0) { active[0] = active[1] = 0; }
+
+	size_t enter() {
+		while (true) {
+			size_t e = epoch.load();
+			active[e & 1]++;
+			if (epoch.load() == e) return e;
+			active[e & 1]--;
+		}
+	}
+	void leave(size_t e) { active[e & 1]--; }
+
+	void synchronize() {
+		std::lock_guard<std::mutex> lock(writer);
+		size_t e = epoch++;
+		while (active[e & 1].load()) std::this_thread::yield();
+	}
+
+	/**
+	 * a read-side section for the lifetime of the guard, or nothing if it is not on
+	 */
+	class guard {
+	public:
+		guard(epochs& e, bool on = true) : owner(on ? &e : nullptr), epoch(on ? e.enter() : 0) {}
+		~guard() { if (owner) owner->leave(epoch); }
+	private:
+		epochs* owner;
+		size_t epoch;
+	};
+
+private:
+	std::atomic<size_t> epoch;
+	std::atomic<size_t> active[2];
+	std::mutex writer;
+};
@@ -0,0 +1,78 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * prune.h: Visitation-based pruning of the weight tables for evaluation-only deployments
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <iostream>
+#include "board.h"
+#include "agent.h"
+#include "tool.h"
+
+/**
+ * record the feature indices visited by the greedy self-play of a player,
+ * including every afterstate evaluated for a decision, and save the visited entries
+ * as compact tables; other entries are answered with a default value
+ *
+ * options, e.g.,
+ * --prune="games=10000 threads=4 save=compact.bin miss=0"
+ */
+class pruner : public tool {
+public:
+	pruner(const player& play, const std::string& args = "") : tool("name=prune games=1000 threads=1 seed=0 miss=0 " + args),
+		play(play), games(meta["games"]), threads(std::max(size_t(meta["threads"]), size_t(1))), seed(meta["seed"]) {}
+
+	void run() {
+		if (games == 0) std::exit(-1);
+		std::vector<std::vector<bool>> visited;
+		std::mutex merge;
+		parallel(threads, [&](size_t id) {
+			std::vector<std::vector<bool>> local;
+			visit(id, local);
+			std::lock_guard<std::mutex> lock(merge);
+			if (local.empty()) return; // no games for this thread, see games < threads
+			if (visited.empty()) visited.swap(local);
+			for (size_t i = 0; i < local.size(); i++)
+				for (size_t j = 0; j < local[i].size(); j++)
+					if (local[i][j]) visited[i][j] = true;
+		});
+
+		std::cout << "prune = " << games << " games, kept ";
+		for (size_t i = 0; i < visited.size(); i++) {
+			size_t kept = std::count(visited[i].begin(), visited[i].end(), true);
+			std::cout << (i ? "|" : "") << kept << " (" << (kept * 100.0 / visited[i].size()) << "%)";
+		}
+		std::cout << std::endl;
+		if (meta.find("save") != meta.end())
+			play.save_compact(meta["save"], visited, float(meta["miss"]));
+	}
+
+protected:
+	/**
+	 * the self-play of the games id, id+threads, ..., which visits all afterstates of each state
+	 */
+	void visit(size_t id, std::vector<std::vector<bool>>& visited) const {
+		for (size_t g = id; g < games; g += threads) {
+			self_play(play, seed + g, nullptr, [&](const board& state, const player::decision&) {
+				for (int op : { 0, 1, 2, 3 }) {
+					board after = state;
+					if (after.slide(op) != -1) play.visit(after, visited);
+				}
+				return true;
+			});
+		}
+	}
+
+private:
+	const player& play;
+	size_t games;
+	size_t threads;
+	size_t seed;
+};
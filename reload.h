@@ -0,0 +1,125 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * reload.h: Hot swapping of published tables by a background loader
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include "parallel.h"
+
+/**
+ * hot swapping of a published object, e.g., the weight tables of a player by "reload=weights.bin"
+ *
+ * the object is read by the requests within an epoch (see section); a loader thread reads a new
+ * object in the background on SIGHUP (from the path given to start) or on request(path), publishes
+ * it, and deletes the old one once the requests that started before the swap have left, see epochs
+ */
+template<typename type>
+class reloader {
+public:
+	/**
+	 * read the object of a file, or return nullptr if it does not fit the current one
+	 */
+	typedef std::function<type*(const std::string& path)> reader;
+
+	reloader(published<type>& object) : object(object), swapping(false), stopping(false) {}
+	~reloader() { stop(); }
+
+	bool enabled() const { return swapping; }
+
+	void start(const std::string& path, reader read) {
+		swapping = true;
+		hangup() = false;
+		std::signal(SIGHUP, [](int) { hangup() = true; });
+		loader = std::thread([this, path, read]() {
+			while (!stopping) {
+				std::string next;
+				if (hangup().exchange(false)) next = path;
+				else if (!requests.try_pop(next)) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(50));
+					continue;
+				}
+				swap(next, read);
+			}
+		});
+	}
+	void stop() {
+		if (!loader.joinable()) return;
+		stopping = true;
+		loader.join();
+		std::signal(SIGHUP, SIG_DFL);
+	}
+
+	/**
+	 * queue a reload of the object from a file, return false if hot swapping is not enabled
+	 */
+	bool request(const std::string& path) {
+		if (!swapping) return false;
+		std::string next = path;
+		requests.push(std::move(next));
+		return true;
+	}
+
+	/**
+	 * a read-side section of a request (see epochs), which also pins the object read by the calls
+	 * of this thread until the outermost section of this reloader leaves, so that a swap in the
+	 * middle of a request never mixes the old and the new objects, not even within a batch
+	 */
+	struct pin {
+		const reloader* owner;
+		type* object;
+	};
+	static pin& pinned() {
+		static thread_local pin p = { nullptr, nullptr };
+		return p;
+	}
+	class section {
+	public:
+		section(const reloader& owner) : reading(owner.readers, owner.swapping), saved(pinned()) {
+			if (owner.swapping && saved.owner != &owner) pinned() = { &owner, owner.object.get() };
+		}
+		~section() { pinned() = saved; }
+	private:
+		epochs::guard reading;
+		pin saved;
+	};
+
+	/**
+	 * the object pinned by the section of this thread, or the published one without hot swapping
+	 */
+	type& view() const {
+		if (!swapping) return *object;
+		const pin& p = pinned();
+		return p.owner == this ? *p.object : *object;
+	}
+
+private:
+	void swap(const std::string& path, const reader& read) {
+		std::unique_ptr<type> fresh(read(path));
+		if (!fresh) return;
+		std::unique_ptr<type> old(object.exchange(fresh.release()));
+		readers.synchronize();
+		std::cerr << "reload = " << path << std::endl;
+	}
+
+	static std::atomic<bool>& hangup() { static std::atomic<bool> flag(false); return flag; }
+
+private:
+	published<type>& object;
+	mutable epochs readers;
+	bool swapping;
+	std::atomic<bool> stopping;
+	channel<std::string> requests;
+	std::thread loader;
+};
@@ -0,0 +1,220 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * slide.h: Sliding many boards at once in SIMD lanes
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <immintrin.h>
+#include "board.h"
+#include "cpu.h"
+
+/**
+ * the cells of the 4 lines of each direction, from the wall that tiles slide toward
+ * i.e., cell(op, l, j) is the j-th cell of the l-th line when sliding in direction op
+ */
+struct slide_lines {
+	static constexpr unsigned cell(unsigned op, unsigned l, unsigned j) {
+		return op == 0 ? j * 4 + l : op == 1 ? l * 4 + 3 - j : op == 2 ? (3 - j) * 4 + l : l * 4 + j;
+	}
+};
+
+/**
+ * the rewards of merged tiles, padded to 32 entries for vector lookups
+ */
+alignas(64) static const int32_t slide_fib[32] = {
+	0, 1, 2, 3, 5, 8, 13, 21, 34, 55, 89, 144, 233, 377, 610, 987,
+	1597, 2584, 4181, 6765, 10946, 17711, 28657, 46368, 75025, 121393,
+};
+
+/**
+ * slide n packed boards in the same direction
+ * reward[k] is the reward of the k-th board, or -1 if it is unchanged (an illegal move),
+ * as returned by board::slide
+ *
+ * each board is a lane of 32-bit cells, i.e., 8 boards with AVX2 and 16 boards with AVX-512;
+ * a line is compacted by 6 conditional shifts, then the merges follow the rule of slide_left()
+ * (adjacent Fibonacci numbers, or two 1-tiles) as masks of the 3 pairs of the compacted line
+ *
+ * the AVX-512 kernel uses the explicitly masked forms of some intrinsics, which are equivalent
+ * but avoid the uninitialized placeholders of the unmasked forms in some GCC versions
+ */
+inline void slides_generic(const board::packed* in, board::packed* out, unsigned op, size_t n, board::reward* reward) {
+	for (size_t k = 0; k < n; k++) {
+		board b(in[k]);
+		reward[k] = b.slide(op);
+		out[k] = b.pack();
+	}
+}
+
+__attribute__((target("avx2")))
+inline void slides_avx2(const board::packed* in, board::packed* out, unsigned op, size_t n, board::reward* reward) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i minus = _mm256_set1_epi32(-1);
+	const __m256i byte = _mm256_set1_epi32(0xff);
+	const __m256i lane = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+	board::packed pad_in[8], pad_out[8];
+	board::reward pad_reward[8];
+	for (size_t k = 0; k < n; k += 8) {
+		if (k + 8 > n) { // the tail is padded to a full block of empty boards
+			std::fill(std::copy(in + k, in + n, pad_in), pad_in + 8, board::packed());
+			slides_avx2(pad_in, pad_out, op, 8, pad_reward);
+			std::copy(pad_out, pad_out + (n - k), out + k);
+			std::copy(pad_reward, pad_reward + (n - k), reward + k);
+			return;
+		}
+		const int* src = reinterpret_cast<const int*>(in + k);
+		__m256i cell[16], orig[16];
+		for (unsigned r = 0; r < 4; r++) {
+			__m256i row = _mm256_i32gather_epi32(src, _mm256_add_epi32(lane, _mm256_set1_epi32(r)), 4);
+			for (unsigned c = 0; c < 4; c++)
+				orig[r * 4 + c] = _mm256_and_si256(_mm256_srlv_epi32(row, _mm256_set1_epi32(c * 8)), byte);
+		}
+		__m256i score = zero, diff = zero;
+		for (unsigned l = 0; l < 4; l++) {
+			__m256i x[4];
+			for (unsigned j = 0; j < 4; j++) x[j] = orig[slide_lines::cell(op & 3, l, j)];
+			for (unsigned pass = 3; pass > 0; pass--) {
+				for (unsigned j = 0; j < pass; j++) {
+					__m256i z = _mm256_cmpeq_epi32(x[j], zero);
+					x[j] = _mm256_or_si256(x[j], _mm256_and_si256(z, x[j + 1]));
+					x[j + 1] = _mm256_andnot_si256(z, x[j + 1]);
+				}
+			}
+			__m256i can[3], merged[3];
+			for (unsigned j = 0; j < 3; j++) {
+				__m256i d = _mm256_sub_epi32(x[j], x[j + 1]);
+				__m256i adjacent = _mm256_or_si256(_mm256_cmpeq_epi32(d, one), _mm256_cmpeq_epi32(d, minus));
+				__m256i ones = _mm256_and_si256(_mm256_cmpeq_epi32(x[j], one), _mm256_cmpeq_epi32(x[j + 1], one));
+				can[j] = _mm256_andnot_si256(_mm256_cmpeq_epi32(x[j + 1], zero), _mm256_or_si256(adjacent, ones));
+				merged[j] = _mm256_add_epi32(_mm256_max_epu32(x[j], x[j + 1]), one);
+			}
+			__m256i m01 = can[0];
+			__m256i m12 = _mm256_andnot_si256(m01, can[1]);
+			__m256i m23 = _mm256_andnot_si256(m12, can[2]);
+			__m256i y[4];
+			y[0] = _mm256_blendv_epi8(x[0], merged[0], m01);
+			__m256i tail1 = _mm256_blendv_epi8(x[2], merged[2], m23), tail2 = _mm256_andnot_si256(m23, x[3]);
+			y[1] = _mm256_blendv_epi8(_mm256_blendv_epi8(x[1], merged[1], m12), tail1, m01);
+			y[2] = _mm256_blendv_epi8(_mm256_blendv_epi8(tail1, x[3], m12), tail2, m01);
+			y[3] = _mm256_andnot_si256(_mm256_or_si256(_mm256_or_si256(m01, m12), m23), x[3]);
+			for (unsigned j = 0; j < 3; j++) {
+				__m256i m = j == 0 ? m01 : j == 1 ? m12 : m23;
+				score = _mm256_add_epi32(score, _mm256_and_si256(m, _mm256_i32gather_epi32(slide_fib, merged[j], 4)));
+			}
+			for (unsigned j = 0; j < 4; j++) {
+				unsigned p = slide_lines::cell(op & 3, l, j);
+				cell[p] = y[j];
+				diff = _mm256_or_si256(diff, _mm256_xor_si256(y[j], orig[p]));
+			}
+		}
+		__m256i unchanged = _mm256_cmpeq_epi32(diff, zero);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(reward + k), _mm256_blendv_epi8(score, minus, unchanged));
+
+		__m256i row[4];
+		for (unsigned r = 0; r < 4; r++) {
+			row[r] = cell[r * 4];
+			for (unsigned c = 1; c < 4; c++)
+				row[r] = _mm256_or_si256(row[r], _mm256_sllv_epi32(cell[r * 4 + c], _mm256_set1_epi32(c * 8)));
+		}
+		__m256i t0 = _mm256_unpacklo_epi32(row[0], row[1]), t1 = _mm256_unpackhi_epi32(row[0], row[1]);
+		__m256i t2 = _mm256_unpacklo_epi32(row[2], row[3]), t3 = _mm256_unpackhi_epi32(row[2], row[3]);
+		__m256i b[4] = { _mm256_unpacklo_epi64(t0, t2), _mm256_unpackhi_epi64(t0, t2),
+		                 _mm256_unpacklo_epi64(t1, t3), _mm256_unpackhi_epi64(t1, t3) };
+		for (unsigned i = 0; i < 4; i++) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out[k + i].cell), _mm256_castsi256_si128(b[i]));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out[k + i + 4].cell), _mm256_extracti128_si256(b[i], 1));
+		}
+	}
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline void slides_avx512(const board::packed* in, board::packed* out, unsigned op, size_t n, board::reward* reward) {
+	const __m512i zero = _mm512_setzero_si512();
+	const __m512i one = _mm512_set1_epi32(1);
+	const __m512i minus = _mm512_set1_epi32(-1);
+	const __m512i byte = _mm512_set1_epi32(0xff);
+	const __m512i lane = _mm512_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 44, 48, 52, 56, 60);
+	const __m512i fib_lo = _mm512_load_si512(slide_fib), fib_hi = _mm512_load_si512(slide_fib + 16);
+	board::packed pad_in[16], pad_out[16];
+	board::reward pad_reward[16];
+	for (size_t k = 0; k < n; k += 16) {
+		if (k + 16 > n) { // the tail is padded to a full block of empty boards
+			std::fill(std::copy(in + k, in + n, pad_in), pad_in + 16, board::packed());
+			slides_avx512(pad_in, pad_out, op, 16, pad_reward);
+			std::copy(pad_out, pad_out + (n - k), out + k);
+			std::copy(pad_reward, pad_reward + (n - k), reward + k);
+			return;
+		}
+		int* src = reinterpret_cast<int*>(const_cast<board::packed*>(in + k));
+		int* dst = reinterpret_cast<int*>(out + k);
+		__m512i cell[16], orig[16];
+		for (unsigned r = 0; r < 4; r++) {
+			__m512i row = _mm512_mask_i32gather_epi32(zero, 0xffff, _mm512_add_epi32(lane, _mm512_set1_epi32(r)), src, 4);
+			for (unsigned c = 0; c < 4; c++)
+				orig[r * 4 + c] = _mm512_and_si512(_mm512_maskz_srlv_epi32(0xffff, row, _mm512_set1_epi32(c * 8)), byte);
+		}
+		__m512i score = zero;
+		__mmask16 changed = 0;
+		for (unsigned l = 0; l < 4; l++) {
+			__m512i x[4];
+			for (unsigned j = 0; j < 4; j++) x[j] = orig[slide_lines::cell(op & 3, l, j)];
+			for (unsigned pass = 3; pass > 0; pass--) {
+				for (unsigned j = 0; j < pass; j++) {
+					__mmask16 z = _mm512_cmpeq_epi32_mask(x[j], zero);
+					x[j] = _mm512_mask_mov_epi32(x[j], z, x[j + 1]);
+					x[j + 1] = _mm512_mask_mov_epi32(x[j + 1], z, zero);
+				}
+			}
+			__mmask16 can[3];
+			__m512i merged[3];
+			for (unsigned j = 0; j < 3; j++) {
+				__m512i d = _mm512_sub_epi32(x[j], x[j + 1]);
+				__mmask16 adjacent = _mm512_cmpeq_epi32_mask(d, one) | _mm512_cmpeq_epi32_mask(d, minus);
+				__mmask16 ones = _mm512_cmpeq_epi32_mask(x[j], one) & _mm512_cmpeq_epi32_mask(x[j + 1], one);
+				can[j] = _mm512_cmpneq_epi32_mask(x[j + 1], zero) & (adjacent | ones);
+				merged[j] = _mm512_add_epi32(_mm512_maskz_max_epu32(0xffff, x[j], x[j + 1]), one);
+			}
+			__mmask16 m01 = can[0];
+			__mmask16 m12 = ~m01 & can[1];
+			__mmask16 m23 = ~m12 & can[2];
+			__m512i y[4];
+			y[0] = _mm512_mask_mov_epi32(x[0], m01, merged[0]);
+			__m512i tail1 = _mm512_mask_mov_epi32(x[2], m23, merged[2]), tail2 = _mm512_mask_mov_epi32(x[3], m23, zero);
+			y[1] = _mm512_mask_mov_epi32(_mm512_mask_mov_epi32(x[1], m12, merged[1]), m01, tail1);
+			y[2] = _mm512_mask_mov_epi32(_mm512_mask_mov_epi32(tail1, m12, x[3]), m01, tail2);
+			y[3] = _mm512_mask_mov_epi32(x[3], m01 | m12 | m23, zero);
+			score = _mm512_mask_add_epi32(score, m01, score, _mm512_permutex2var_epi32(fib_lo, merged[0], fib_hi));
+			score = _mm512_mask_add_epi32(score, m12, score, _mm512_permutex2var_epi32(fib_lo, merged[1], fib_hi));
+			score = _mm512_mask_add_epi32(score, m23, score, _mm512_permutex2var_epi32(fib_lo, merged[2], fib_hi));
+			for (unsigned j = 0; j < 4; j++) {
+				unsigned p = slide_lines::cell(op & 3, l, j);
+				cell[p] = y[j];
+				changed |= _mm512_cmpneq_epi32_mask(y[j], orig[p]);
+			}
+		}
+		_mm512_storeu_si512(reward + k, _mm512_mask_mov_epi32(minus, changed, score));
+
+		for (unsigned r = 0; r < 4; r++) {
+			__m512i row = cell[r * 4];
+			for (unsigned c = 1; c < 4; c++)
+				row = _mm512_or_si512(row, _mm512_maskz_sllv_epi32(0xffff, cell[r * 4 + c], _mm512_set1_epi32(c * 8)));
+			_mm512_i32scatter_epi32(dst, _mm512_add_epi32(lane, _mm512_set1_epi32(r)), row, 4);
+		}
+	}
+}
+
+inline void slides(const board::packed* in, board::packed* out, unsigned op, size_t n, board::reward* reward) {
+	switch (cpu::level()) {
+	case cpu::avx512: return slides_avx512(in, out, op, n, reward);
+	case cpu::avx2:   return slides_avx2(in, out, op, n, reward);
+	default:          return slides_generic(in, out, op, n, reward);
+	}
+}
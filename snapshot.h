@@ -0,0 +1,63 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * snapshot.h: Exact and resumable snapshots of the training state
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include "agent.h"
+#include "statistic.h"
+
+/**
+ * the whole state of a training run between two episodes, i.e., the statistic (the episode
+ * counter and the episodes of the current block, or all the retained episodes if --save= or
+ * --summary needs them, up to --limit=), the random engine of the environment,
+ * and the tables and the accumulators of the player, see save_state() of each of them
+ *
+ * a run restored from a snapshot continues exactly as the original run would have,
+ * given the same arguments, e.g.,
+ * ./2584 --total=100000 --block=1000 --play="init alpha=0.1" --snapshot=run.snap --resume=run.snap
+ */
+class snapshot {
+public:
+	/**
+	 * write a snapshot to a temporary file and rename it, so that an interrupted write
+	 * never replaces the previous snapshot
+	 */
+	static bool save(const std::string& path, const statistic& stat, const agent& play, const agent& evil, bool history = true) {
+		std::string temp = path + ".tmp";
+		std::ofstream out(temp, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) return false;
+		out.write(magic, std::strlen(magic));
+		stat.save_state(out, history);
+		evil.save_state(out);
+		play.save_state(out);
+		out.close();
+		if (!out) return false;
+		return std::rename(temp.c_str(), path.c_str()) == 0;
+	}
+
+	/**
+	 * restore a snapshot, return false if it cannot be opened or is not a snapshot
+	 */
+	static bool load(const std::string& path, statistic& stat, agent& play, agent& evil) {
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		if (!in.is_open()) return false;
+		char head[16] = {};
+		if (!in.read(head, std::strlen(magic)) || std::strcmp(head, magic) != 0) return false;
+		stat.load_state(in);
+		evil.load_state(in);
+		play.load_state(in);
+		return bool(in);
+	}
+
+private:
+	static constexpr const char* magic = "2584snap\n";
+};
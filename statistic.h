@@ -9,13 +9,16 @@
 
 #pragma once
 #include <list>
+#include <iterator>
 #include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <functional>
 #include "board.h"
 #include "action.h"
 #include "agent.h"
 #include "episode.h"
+#include "memory.h"
 
 class statistic {
 public:
@@ -30,7 +33,12 @@ public:
 		: total(total),
 		  block(block ? block : total),
 		  limit(limit ? limit : total),
-		  count(0) {}
+		  count(0) {
+		memory::track("statistic", this, [this]() { return bytes(); });
+	}
+	~statistic() {
+		memory::untrack(this);
+	}
 
 public:
 	/**
@@ -38,6 +46,7 @@ public:
 	 *
 	 * the format would be
 	 * 1000   avg = 273901, max = 382324, ops = 241563 (170543|896715)
+	 *        mem = 117.6M (statistic 5.8M, net 111.8M, history 160.0K), rss = 120.4M, peak = 120.4M
 	 *        512     100%   (0.3%)
 	 *        1024    99.7%  (0.2%)
 	 *        2048    99.5%  (1.1%)
@@ -52,6 +61,8 @@ public:
 	 *  'ops = 241563 (170543|896715)': the average speed is 241563
 	 *                                  the average speed of player is 170543
 	 *                                  the average speed of environment is 896715
+	 *  'mem = 117.6M (...)': the bytes held by each subsystem, see memory.h
+	 *  'rss = 120.4M, peak = 120.4M': the current and the peak resident set size
 	 *  '93.7%': 93.7% (937 games) reached 8192-tiles (a.k.a. win rate of 8192-tile)
 	 *  '22.4%': 22.4% (224 games) terminated with 8192-tiles (the largest)
 	 */
@@ -86,6 +97,11 @@ public:
 		std::cout <<      "|" << (eop * 1000.0 / edu) << ")";
 		std::cout << std::endl;
 		std::cout.copyfmt(ff);
+		std::cout << "\t" << memory::footprint() << std::endl;
+		for (auto& report : reports) {
+			std::string line = report();
+			if (line.size()) std::cout << "\t" << line << std::endl;
+		}
 
 		if (!tstat) return;
 		for (size_t t = 0, c = 0; c < blk; c += stat[t++]) {
@@ -99,6 +115,13 @@ public:
 		std::cout << std::endl;
 	}
 
+	/**
+	 * attach a report to be printed with each block, e.g., the learning dynamics of a player
+	 */
+	void attach(const std::function<std::string()>& report) {
+		reports.push_back(report);
+	}
+
 	void summary() const {
 		auto block_temp = block;
 		const_cast<statistic&>(*this).block = data.size();
@@ -110,8 +133,15 @@ public:
 		return count >= total;
 	}
 
+	size_t episodes() const {
+		return count;
+	}
+	bool is_block_end() const {
+		return count % block == 0;
+	}
 	void open_episode(const std::string& flag = "") {
-		if (count++ >= limit) data.pop_front();
+		if (data.size() >= limit) data.pop_front();
+		count++;
 		data.emplace_back();
 		data.back().open_episode(flag);
 	}
@@ -121,6 +151,15 @@ public:
 		if (count % block == 0) show();
 	}
 
+	/**
+	 * the bytes held by the retained episodes
+	 */
+	size_t bytes() const {
+		size_t sum = sizeof(statistic);
+		for (const episode& ep : data) sum += ep.bytes() + 2 * sizeof(void*);
+		return sum;
+	}
+
 	episode& at(size_t i) {
 		auto it = data.begin();
 		while (i--) it++;
@@ -133,6 +172,27 @@ public:
 		return data.back();
 	}
 
+	/**
+	 * the state needed to continue exactly, i.e., the episode counter and the episodes of the
+	 * current block, or all the retained episodes if the history is needed (e.g., by --save),
+	 * see snapshot.h
+	 */
+	void save_state(std::ostream& out, bool history = true) const {
+		size_t n = history ? data.size() : std::min(data.size(), count % block);
+		out << count << ' ' << n << '\n';
+		for (auto it = std::prev(data.end(), n); it != data.end(); it++) out << *it << '\n';
+	}
+	void load_state(std::istream& in) {
+		size_t n = 0;
+		in >> count >> n;
+		in.ignore(1);
+		data.clear();
+		std::string line;
+		for (size_t i = 0; i < n && std::getline(in, line); i++) {
+			data.emplace_back();
+			std::stringstream(line) >> data.back();
+		}
+	}
 	friend std::ostream& operator <<(std::ostream& out, const statistic& stat) {
 		for (const episode& rec : stat.data) out << rec << std::endl;
 		return out;
@@ -153,4 +213,5 @@ private:
 	size_t limit;
 	size_t count;
 	std::list<episode> data;
+	std::vector<std::function<std::string()>> reports;
 };
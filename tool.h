@@ -0,0 +1,108 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * tool.h: Self-play, option and thread helpers shared by the tools
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include "board.h"
+#include "agent.h"
+
+/**
+ * base of the tools run instead of the games (--distill, --prune, --book, --tune, --bench,
+ * --farm and --train), with the helpers they share
+ *
+ * the games of a tool are seeded by their index, i.e., game g plays against the environment
+ * seeded by seed+g, so that the results do not depend on the number of threads
+ */
+class tool : public agent {
+public:
+	tool(const std::string& args = "") : agent("role=tool " + args) {}
+
+	/**
+	 * a game of the player against the environment seeded by seed, return its score
+	 *
+	 * the decisions are appended to path if given; observe(state, move) is called with each
+	 * state before a move of the player and the decision there (whose op is -1 at the end of
+	 * the game), and returns false to stop the game before the move
+	 */
+	template<typename observer>
+	static long self_play(const player& play, size_t seed, player::trajectory* path, observer observe) {
+		rndenv evil("seed=" + std::to_string(seed));
+		board state;
+		evil.take_action(state).apply(state);
+		evil.take_action(state).apply(state);
+		long score = 0;
+		while (true) {
+			player::decision move = play.decide(state);
+			if (!observe(state, move) || move.op == -1) break;
+			score += move.reward;
+			if (path) path->push_back(move.reward, move.after);
+			state = move.after;
+			evil.take_action(state).apply(state);
+		}
+		return score;
+	}
+	static long self_play(const player& play, size_t seed, player::trajectory* path = nullptr) {
+		return self_play(play, seed, path, [](const board&, const player::decision&) { return true; });
+	}
+
+	/**
+	 * the arguments without the given keys, e.g., to construct a player without its save=
+	 */
+	static std::string without(const std::string& args, const std::vector<std::string>& keys) {
+		std::stringstream in(args);
+		std::string res;
+		for (std::string pair; in >> pair; )
+			if (std::find(keys.begin(), keys.end(), pair.substr(0, pair.find('='))) == keys.end()) res += pair + " ";
+		return res;
+	}
+	/**
+	 * whether an option is given to an agent, and its value or def if not given
+	 */
+	static bool given(const agent& who, const std::string& key) {
+		try {
+			who.property(key);
+			return true;
+		} catch (std::out_of_range&) {
+			return false;
+		}
+	}
+	static std::string option(const agent& who, const std::string& key, const std::string& def) {
+		return given(who, key) ? who.property(key) : def;
+	}
+	static size_t option(const agent& who, const std::string& key, size_t def) {
+		std::string v = option(who, key, std::string());
+		return v.size() ? std::stoull(v) : def;
+	}
+
+	/**
+	 * run task(id) in threads of id = 0, 1, ..., threads-1, and wait for them
+	 */
+	template<typename work>
+	static void parallel(size_t threads, work task) {
+		std::vector<std::thread> workers;
+		for (size_t id = 0; id < threads; id++) workers.emplace_back(task, id);
+		for (std::thread& worker : workers) worker.join();
+	}
+	/**
+	 * run task(i) for i = 0, 1, ..., n-1 in threads, each of which takes the next i in turn
+	 */
+	template<typename work>
+	static void parallel_for(size_t threads, size_t n, work task) {
+		std::atomic<size_t> next(0);
+		parallel(threads, [&](size_t) {
+			for (size_t i; (i = next++) < n; ) task(i);
+		});
+	}
+};
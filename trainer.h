@@ -0,0 +1,293 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * trainer.h: Deterministic multi-threaded training by self-play
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include "board.h"
+#include "agent.h"
+#include "tool.h"
+
+/**
+ * train a player by TD(0) self-play in a number of threads, either deterministically (exact=1)
+ * or by hogwild updates (exact=0), e.g., to compare their throughput
+ *
+ * in the deterministic mode, the episodes are played in rounds of sync= episodes on the weights
+ * frozen at the start of the round; the backward pass of each episode is taken over the frozen
+ * weights plus its own adjustments so far, as if it were applied alone, and the net adjustments of
+ * its entries are kept as fixed-point integers (in units of 2^-scale); at the barrier at the end of
+ * the round, each entry gets the mean adjustment of the episodes that touched it, by one thread
+ *
+ * since the integer sums do not depend on the order of the additions, and episode g always uses
+ * the environment seed seed+g, the final weights are bit-identical for a given seed and sync=,
+ * whatever the number of threads and the scheduling of the episodes
+ *
+ * the episodes of a round do not see the adjustments of each other, as with hogwild updates by
+ * as many threads, which is why the entries shared by them take the mean rather than the sum
+ * (the sum overshoots, e.g., from the initial weights); sync= is the number of threads by default,
+ * and larger rounds reduce the waiting at the barriers but learn slower
+ *
+ * note that the deterministic mode costs about 40% of the throughput of the hogwild mode (the
+ * ledgers and the merge), and learns slower per game since the episodes of a round do not see
+ * each other; the search table (table=) is not used, since its hits depend on the episodes
+ * played before by the same thread, and neither is forward pruning (cut=, probcut=)
+ *
+ * in the hogwild mode, each thread applies the updates of its episodes directly to the shared
+ * tables, as the trainer of scaling_bench does, without the value cache and the search table
+ *
+ * the weights are saved by save= of --play, e.g.,
+ * --play="init save=weights.bin" --train="games=10000 threads=4 alpha=0.1 sync=4 exact=1"
+ */
+class parallel_trainer : public tool {
+public:
+	parallel_trainer(const std::string& play_args, const std::string& args = "") :
+		tool("name=train games=1000 threads=1 alpha=0.1 scale=24 exact=1 block=1000 seed=0 " + args),
+		play(play_args + " alpha=" + std::string(meta["alpha"]) + (int(meta["exact"]) ? " table=0" : " cache=0 table=0")), games(meta["games"]),
+		threads(std::max(size_t(meta["threads"]), size_t(1))), sync(threads),
+		unit(std::ldexp(1.0, int(meta["scale"]))), exact(int(meta["exact"])),
+		block(std::max(size_t(meta["block"]), size_t(1))), seed(meta["seed"]), scores(games), moves(games) {
+		if (meta.find("sync") != meta.end()) sync = std::max(size_t(meta["sync"]), size_t(1));
+		if (exact && (given(play, "cut") || given(play, "probcut"))) {
+			std::cerr << "forward pruning is not supported with exact=1" << std::endl;
+			std::exit(-1);
+		}
+		if (exact) {
+			episodes.resize(threads);
+			changes.assign(threads, std::vector<std::vector<change>>(threads));
+			merged.resize(threads);
+			size_t total = 0;
+			for (size_t i = 0; i < play.features() / isomorphism::count; i++)
+				offset.push_back(total), total += play.entries(i);
+			if (total >= ledger<float>::none) {
+				std::cerr << "too many entries for exact=1: " << total << std::endl;
+				std::exit(-1);
+			}
+		}
+	}
+
+	void run() {
+		start = std::chrono::steady_clock::now();
+		reported = 0;
+		if (exact) {
+			for (size_t first = 0; first < games; first += sync)
+				round(first, std::min(first + sync, games));
+		} else {
+			hogwild();
+		}
+		report(games);
+	}
+
+protected:
+	struct change {
+		uint32_t key; // the entry of all tables, see key()
+		int64_t delta;
+	};
+	struct tally {
+		int64_t sum;
+		uint32_t count;
+	};
+
+	/**
+	 * the sums of the entries touched by an episode (or merged by an owner), by open addressing,
+	 * which grows to keep the load below a half
+	 */
+	template<typename sum>
+	class ledger {
+	public:
+		struct slot {
+			uint32_t key;
+			sum value;
+		};
+		static constexpr uint32_t none = ~uint32_t(0);
+
+		ledger() : table(1024, { none, sum() }), used(0) {}
+
+		/**
+		 * make room for n more keys, so that the references of the next n lookups stay valid
+		 */
+		void reserve(size_t n) {
+			if ((used + n) * 2 <= table.size()) return;
+			size_t size = table.size();
+			while ((used + n) * 2 > size) size *= 2;
+			std::vector<slot> old(size, { none, sum() });
+			old.swap(table);
+			for (const slot& e : old)
+				if (e.key != none) table[locate(e.key)] = e;
+		}
+		void prefetch(uint32_t key) const {
+			__builtin_prefetch(&table[hash(key)]);
+		}
+		sum& operator [](uint32_t key) {
+			slot& e = table[locate(key)];
+			used += e.key == none;
+			e.key = key;
+			return e.value;
+		}
+		/**
+		 * visit and remove all keys, in no particular order
+		 */
+		template<typename visit>
+		void drain(visit f) {
+			for (slot& e : table) {
+				if (e.key == none) continue;
+				f(e.key, e.value);
+				e = { none, sum() };
+			}
+			used = 0;
+		}
+
+	private:
+		size_t hash(uint32_t key) const {
+			return (key * 0x9E3779B97F4A7C15ull) >> 24 & (table.size() - 1);
+		}
+		size_t locate(uint32_t key) const {
+			size_t mask = table.size() - 1, i = hash(key);
+			while (table[i].key != key && table[i].key != none) i = (i + 1) & mask;
+			return i;
+		}
+		std::vector<slot> table;
+		size_t used;
+	};
+
+	/**
+	 * play the episodes [first, last) on the frozen weights, then merge their adjustments
+	 */
+	void round(size_t first, size_t last) {
+		std::atomic<size_t> next(first);
+		parallel(threads, [&](size_t id) {
+			std::vector<uint32_t> index(play.features());
+			player::trajectory path;
+			for (size_t g; (g = next++) < last; ) {
+				path.clear();
+				scores[g] = self_play(play, seed + g, &path);
+				moves[g] = path.size();
+				collect(path, index.data(), episodes[id], changes[id]);
+			}
+		});
+
+		parallel(threads, [&](size_t id) {
+			ledger<tally>& own = merged[id];
+			for (size_t t = 0; t < threads; t++) {
+				own.reserve(changes[t][id].size());
+				for (const change& c : changes[t][id]) {
+					tally& e = own[c.key];
+					e.sum += c.delta;
+					e.count++;
+				}
+				changes[t][id].clear();
+			}
+			own.drain([this](uint32_t key, const tally& e) {
+				size_t i = std::upper_bound(offset.begin(), offset.end(), key) - offset.begin() - 1;
+				if (e.sum) play.adjust_entry(i, key - offset[i], float(double(e.sum) / unit / e.count));
+			});
+		});
+		play.invalidate();
+
+		if (last / block != first / block) report(last);
+	}
+
+	/**
+	 * the backward TD(0) pass of close_episode over the frozen weights plus the adjustments of the
+	 * episode so far, so that the values of an episode are the same as if its pass were applied
+	 * alone; the net adjustments of the entries are then converted to fixed-point and split by their
+	 * owners (entry % threads) for the merge
+	 */
+	void collect(const player::trajectory& path, uint32_t* index, ledger<float>& local, std::vector<std::vector<change>>& out) const {
+		const size_t features = play.features();
+		const float alpha = play.learning_rate();
+		std::vector<uint32_t> ahead(features);
+		std::vector<float*> delta(features);
+		float next = 0, frozen = path.size() ? play.estimate_value(path.after[path.size() - 1], index) : 0;
+		for (int t = path.size() - 1; t >= 0; t--) {
+			float before = t > 0 ? play.estimate_value(path.after[t - 1], ahead.data()) : 0;
+			for (size_t k = 0; k < features && t > 0; k++) local.prefetch(key(k, ahead[k]));
+			local.reserve(features);
+			float value = frozen;
+			for (size_t k = 0; k < features; k++) {
+				delta[k] = &local[key(k, index[k])];
+				value += *delta[k];
+			}
+			float target = size_t(t + 1) < path.size() ? path.reward[t + 1] + next : 0;
+			float adjust = alpha * (target - value);
+			for (size_t k = 0; k < features; k++) *delta[k] += adjust;
+			next = frozen;
+			for (size_t k = 0; k < features; k++) next += *delta[k];
+			std::copy(ahead.begin(), ahead.end(), index);
+			frozen = before;
+		}
+		local.drain([&](uint32_t key, float sum) {
+			int64_t fixed = std::llround(double(sum) * unit);
+			if (fixed) out[key % threads].push_back({ key, fixed });
+		});
+	}
+	/**
+	 * the entry of a feature as an offset into all tables, i.e., the offset of its table plus its index
+	 */
+	uint32_t key(size_t feature, uint32_t entry) const {
+		return offset[feature / isomorphism::count] + entry;
+	}
+
+	void hogwild() {
+		std::atomic<size_t> next(0);
+		parallel(threads, [&](size_t id) {
+			player::trajectory path;
+			for (size_t g; (g = next++) < games; ) {
+				path.clear();
+				scores[g] = self_play(play, seed + g, &path);
+				moves[g] = path.size();
+				if (path.empty()) continue;
+				play.adjust_shared(path.after[path.size() - 1], 0, false);
+				for (int t = path.size() - 2; t >= 0; t--)
+					play.adjust_shared(path.after[t], path.reward[t + 1] + play.estimate_value(path.after[t + 1]), false);
+			}
+		});
+		play.invalidate();
+	}
+
+	/**
+	 * the average score of the episodes since the last report, and the throughput so far
+	 */
+	void report(size_t done) {
+		if (done <= reported) return;
+		double sum = 0, steps = 0;
+		for (size_t g = reported; g < done; g++) sum += scores[g];
+		for (size_t g = 0; g < done; g++) steps += moves[g];
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << std::fixed << std::setprecision(1);
+		std::cout << "train = " << done << " games (" << (exact ? "exact" : "hogwild") << ", " << threads << " threads)";
+		std::cout << ", avg = " << sum / (done - reported) << ", " << std::setprecision(2) << (seconds > 0 ? done / seconds : 0) << " games/s, ";
+		std::cout << std::setprecision(0) << (seconds > 0 ? steps / seconds : 0) << " moves/s" << std::endl;
+		reported = done;
+	}
+
+private:
+	player play;
+	size_t games;
+	size_t threads;
+	size_t sync;
+	double unit;
+	bool exact;
+	size_t block;
+	size_t seed;
+	std::vector<long> scores;
+	std::vector<size_t> moves;
+	std::vector<ledger<float>> episodes;
+	std::vector<std::vector<std::vector<change>>> changes;
+	std::vector<ledger<tally>> merged;
+	std::vector<uint32_t> offset;
+	std::chrono::steady_clock::time_point start;
+	size_t reported;
+};
@@ -0,0 +1,119 @@
+/**
+ * Framework for 2048 & 2048-like Games (C++ 11)
+ * tuner.h: Offline tuner of the forward pruning models
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include "board.h"
+#include "agent.h"
+#include "cuts.h"
+#include "tool.h"
+
+/**
+ * fit the models of cut_model from a corpus of positions of the greedy self-play of a player,
+ * i.e., the deep values search(s, d) against the shallow values search(s, 1) for d = 2 ... depth,
+ * by least squares on the even positions
+ *
+ * the odd positions are then searched to the full depth with and without forward pruning
+ * (at the margin cut=), to report how often the pruned search agrees with the full search
+ * and how much time it takes
+ *
+ * options, e.g.,
+ * --tune="games=20 every=100 depth=3 cut=2 threads=4 save=cuts.txt"
+ */
+class cut_tuner : public tool {
+public:
+	cut_tuner(player& play, const std::string& args = "") : tool("name=tune games=20 every=100 depth=3 cut=2 threads=1 seed=0 " + args),
+		play(play), games(meta["games"]), every(std::max(size_t(meta["every"]), size_t(1))), depth(std::max(int(meta["depth"]), 2)),
+		threads(std::max(size_t(meta["threads"]), size_t(1))), seed(meta["seed"]) {}
+
+	void run() {
+		std::vector<board> states = collect();
+		std::vector<std::vector<float>> value(depth + 1, std::vector<float>(states.size()));
+		parallel_for(threads, states.size(), [&](size_t i) {
+			for (unsigned d = 1; d <= depth; d++) {
+				play.begin_search();
+				player::decision move = play.search(states[i], d);
+				value[d][i] = move.reward + move.value;
+			}
+		});
+
+		cut_model model(meta["cut"]);
+		for (unsigned d = 2; d <= depth; d++) {
+			double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+			for (size_t i = 0; i < states.size(); i += 2) {
+				double x = value[1][i], y = value[d][i];
+				n++, sx += x, sy += y, sxx += x * x, sxy += x * y;
+			}
+			double det = n * sxx - sx * sx;
+			double a = det != 0 ? (n * sxy - sx * sy) / det : 1;
+			double b = n ? (sy - a * sx) / n : 0;
+			double sq = 0;
+			for (size_t i = 0; i < states.size(); i += 2) {
+				double r = value[d][i] - (a * value[1][i] + b);
+				sq += r * r;
+			}
+			model.fit(d, a, b, n ? std::sqrt(sq / n) : 0);
+			std::cout << "depth " << d << ": a = " << a << ", b = " << b << ", sigma = " << model.at(d).sigma << std::endl;
+		}
+
+		std::vector<int> full(states.size()), pruned(states.size());
+		double base = validate(states, cut_model(), full);
+		double fast = validate(states, model, pruned);
+		size_t agree = 0, count = 0;
+		for (size_t i = 1; i < states.size(); i += 2, count++) agree += full[i] == pruned[i];
+		std::cout << std::fixed << std::setprecision(1);
+		std::cout << "tune = " << states.size() << " positions, depth = " << depth << ", cut = " << model.margin();
+		std::cout << ", agreement = " << (count ? agree * 100.0 / count : 0) << "%";
+		std::cout << ", time = " << (base > 0 ? fast * 100 / base : 0) << "% (" << std::setprecision(3) << base << "s -> " << fast << "s)" << std::endl;
+
+		if (meta.find("save") != meta.end() && !model.save(meta["save"]))
+			std::exit(-1);
+	}
+
+protected:
+	/**
+	 * every few positions (before the moves of the player) of the greedy self-play
+	 */
+	std::vector<board> collect() const {
+		std::vector<board> states;
+		for (size_t g = 0; g < games; g++) {
+			size_t n = 0;
+			self_play(play, seed + g, nullptr, [&](const board& state, const player::decision& move) {
+				if (move.op != -1 && n++ % every == 0) states.push_back(state);
+				return true;
+			});
+		}
+		return states;
+	}
+
+	/**
+	 * search the odd positions to the full depth with the given models, return the seconds
+	 */
+	double validate(const std::vector<board>& states, const cut_model& model, std::vector<int>& ops) {
+		play.forward_pruning(model);
+		auto start = std::chrono::steady_clock::now();
+		parallel_for(threads, states.size() / 2, [&](size_t j) { play.begin_search(); ops[j * 2 + 1] = play.search(states[j * 2 + 1], depth).op; });
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		play.forward_pruning(cut_model());
+		return seconds;
+	}
+
+private:
+	player& play;
+	size_t games;
+	size_t every;
+	unsigned depth;
+	size_t threads;
+	size_t seed;
+};
@@ -11,28 +11,95 @@
 #include <iostream>
 #include <vector>
 #include <utility>
+#include <new>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
+/**
+ * allocator for cache-line aligned storage of the lookup tables
+ */
+template<typename T, size_t align = 64>
+struct aligned_allocator {
+	typedef T value_type;
+	template<typename U> struct rebind { typedef aligned_allocator<U, align> other; };
+
+	aligned_allocator() {}
+	template<typename U> aligned_allocator(const aligned_allocator<U, align>&) {}
+
+	T* allocate(size_t n) {
+		void* ptr = nullptr;
+		if (posix_memalign(&ptr, align, n * sizeof(T)) != 0) throw std::bad_alloc();
+		return static_cast<T*>(ptr);
+	}
+	void deallocate(T* ptr, size_t) { std::free(ptr); }
+
+	template<typename U> bool operator ==(const aligned_allocator<U, align>&) const { return true; }
+	template<typename U> bool operator !=(const aligned_allocator<U, align>&) const { return false; }
+};
+
+/**
+ * lookup table of an n-tuple
+ *
+ * the entries are either owned, or a view of a region shared with others, e.g., a memory-mapped
+ * weight file, which is kept alive as long as any table refers to it
+ */
 class weight {
 public:
 	typedef float type;
+	typedef std::vector<type, aligned_allocator<type>> container;
 
 public:
-	weight() {}
-	weight(size_t len) : value(len) {}
-	weight(weight&& f) : value(std::move(f.value)) {}
-	weight(const weight& f) = default;
+	weight() : table(nullptr), length(0), bias(0) {}
+	weight(size_t len) : value(len), table(value.data()), length(len), bias(0) {}
+	weight(std::shared_ptr<void> region, type* entries, size_t len) : table(entries), length(len), bias(0), region(region) {}
+	weight(weight&& f) noexcept : value(std::move(f.value)), table(f.table), length(f.length), bias(f.bias), region(std::move(f.region)) {
+		f.table = nullptr;
+		f.length = 0;
+	}
+	weight(const weight& f) : value(f.value), table(f.region ? f.table : value.data()), length(f.length), bias(f.bias), region(f.region) {}
+
+	weight& operator =(const weight& f) {
+		value = f.value;
+		table = f.region ? f.table : value.data();
+		length = f.length;
+		bias = f.bias;
+		region = f.region;
+		return *this;
+	}
+	type& operator[] (size_t i) { return table[i]; }
+	const type& operator[] (size_t i) const { return table[i]; }
+	size_t size() const { return length; }
+	type* data() { return table; }
+	const type* data() const { return table; }
+	bool mapped() const { return region != nullptr; }
 
-	weight& operator =(const weight& f) = default;
-	type& operator[] (size_t i) { return value[i]; }
-	const type& operator[] (size_t i) const { return value[i]; }
-	size_t size() const { return value.size(); }
+	/**
+	 * a constant added to all entries, which is applied lazily:
+	 * the entries hold the differences from it, and it is only materialized when saving
+	 */
+	type offset() const { return bias; }
+	void offset(type v) { bias = v; }
 
 public:
 	friend std::ostream& operator <<(std::ostream& out, const weight& w) {
-		auto& value = w.value;
-		uint64_t size = value.size();
+		const type* value = w.table;
+		uint64_t size = w.length;
 		out.write(reinterpret_cast<const char*>(&size), sizeof(uint64_t));
-		out.write(reinterpret_cast<const char*>(value.data()), sizeof(type) * size);
+		if (w.bias == 0) {
+			out.write(reinterpret_cast<const char*>(value), sizeof(type) * size);
+			return out;
+		}
+		type chunk[4096];
+		for (size_t i = 0; i < size; i += 4096) {
+			size_t n = std::min<size_t>(4096, size - i);
+			for (size_t j = 0; j < n; j++) chunk[j] = value[i + j] + w.bias;
+			out.write(reinterpret_cast<const char*>(chunk), sizeof(type) * n);
+		}
 		return out;
 	}
 	friend std::istream& operator >>(std::istream& in, weight& w) {
@@ -41,9 +108,136 @@ public:
 		in.read(reinterpret_cast<char*>(&size), sizeof(uint64_t));
 		value.resize(size);
 		in.read(reinterpret_cast<char*>(value.data()), sizeof(type) * size);
+		w.table = value.data();
+		w.length = size;
+		w.bias = 0;
+		w.region.reset();
+		return in;
+	}
+
+protected:
+	container value;
+	type* table;
+	size_t length;
+	type bias;
+	std::shared_ptr<void> region;
+};
+
+/**
+ * compact lookup table that keeps only the visited entries of a weight table, for evaluation only
+ *
+ * the entries are kept in an open-addressing hash table of buckets, each a cache line of 8 keys and
+ * their values, probed linearly at a load factor of at most 0.5; the keys of a bucket are filled in
+ * order, so that a lookup ends at its key or at the first empty key, and almost every lookup,
+ * hit or miss, touches a single cache line; misses return a default value
+ */
+class sparse_weight {
+public:
+	typedef weight::type type;
+
+public:
+	sparse_weight() : length(0), count_(0), miss(0) {}
+	sparse_weight(const weight& w, const std::vector<bool>& visited, type miss = 0) : length(w.size()), count_(0), miss(miss) {
+		for (size_t i = 0; i < length; i++) count_ += visited[i];
+		slot.assign(count_ / (width / 2) + 1, bucket());
+		for (size_t i = 0; i < length; i++)
+			if (visited[i]) insert(i, w[i] + w.offset());
+	}
+
+	type operator[] (size_t i) const {
+		for (size_t h = hash(i); ; h = (h + 1 < slot.size()) ? h + 1 : 0) {
+			const bucket& b = slot[h];
+#if defined(__SSE2__)
+			const __m128i* key = reinterpret_cast<const __m128i*>(b.key);
+			__m128i lo = _mm_load_si128(key), hi = _mm_load_si128(key + 1);
+			__m128i want = _mm_set1_epi32(int32_t(i)), none = _mm_set1_epi32(-1);
+			unsigned hit = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(lo, want)))
+			             | _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(hi, want))) << 4;
+			if (hit) return b.value[__builtin_ctz(hit)];
+			if (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(hi, none)))) return miss;
+#else
+			for (unsigned k = 0; k < width; k++) {
+				if (b.key[k] == i) return b.value[k];
+				if (b.key[k] == empty) return miss;
+			}
+#endif
+		}
+	}
+	void prefetch(size_t i) const {
+		__builtin_prefetch(slot.data() + hash(i));
+	}
+
+	/**
+	 * the length of the original table, and the number of entries kept
+	 */
+	size_t size() const { return length; }
+	size_t count() const { return count_; }
+	size_t bytes() const { return slot.capacity() * sizeof(bucket); }
+	const void* data() const { return slot.data(); }
+
+public:
+	friend std::ostream& operator <<(std::ostream& out, const sparse_weight& w) {
+		uint64_t size = w.length, count = w.count_;
+		out.write(reinterpret_cast<const char*>(&size), sizeof(uint64_t));
+		out.write(reinterpret_cast<const char*>(&count), sizeof(uint64_t));
+		out.write(reinterpret_cast<const char*>(&w.miss), sizeof(type));
+		for (const bucket& b : w.slot) {
+			for (unsigned k = 0; k < width && b.key[k] != empty; k++) {
+				entry e = { b.key[k], b.value[k] };
+				out.write(reinterpret_cast<const char*>(&e), sizeof(entry));
+			}
+		}
+		return out;
+	}
+	friend std::istream& operator >>(std::istream& in, sparse_weight& w) {
+		uint64_t size = 0, count = 0;
+		in.read(reinterpret_cast<char*>(&size), sizeof(uint64_t));
+		in.read(reinterpret_cast<char*>(&count), sizeof(uint64_t));
+		in.read(reinterpret_cast<char*>(&w.miss), sizeof(type));
+		w.length = size;
+		w.count_ = count;
+		w.slot.assign(count / (width / 2) + 1, bucket());
+		for (size_t i = 0; i < count; i++) {
+			entry e;
+			in.read(reinterpret_cast<char*>(&e), sizeof(entry));
+			w.insert(e.key, e.value);
+		}
 		return in;
 	}
 
 protected:
-	std::vector<type> value;
+	static constexpr uint32_t empty = -1u;
+	static constexpr unsigned width = 8;
+
+	size_t hash(size_t i) const {
+		return (uint64_t(uint32_t(i * 0x9e3779b1u)) * slot.size()) >> 32;
+	}
+	void insert(size_t i, type value) {
+		for (size_t h = hash(i); ; h = (h + 1 < slot.size()) ? h + 1 : 0) {
+			bucket& b = slot[h];
+			for (unsigned k = 0; k < width; k++) {
+				if (b.key[k] != empty) continue;
+				b.key[k] = uint32_t(i);
+				b.value[k] = value;
+				return;
+			}
+		}
+	}
+
+	/**
+	 * an entry as saved in the file, and a bucket of entries as kept in memory
+	 */
+	struct entry {
+		uint32_t key;
+		type value;
+	};
+	struct alignas(64) bucket {
+		uint32_t key[width];
+		type value[width];
+		bucket() { std::fill(key, key + width, empty); std::fill(value, value + width, type(0)); }
+	};
+	size_t length;
+	size_t count_;
+	type miss;
+	std::vector<bucket, aligned_allocator<bucket>> slot;
 };